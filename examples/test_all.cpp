@@ -1,4 +1,9 @@
+#include <atomic>
+#include <bit>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
 
 #include <trippin/common.h>
 #include <trippin/iofs.h>
@@ -6,6 +11,7 @@
 #include <trippin/math.h>
 #include <trippin/memory.h>
 #include <trippin/string.h>
+#include <trippin/sync.h>
 #include <trippin/util.h>
 
 #include "trippin/error.h"
@@ -21,7 +27,36 @@ static void arrays();
 static void strings();
 static void hashmaps();
 static void filesystem();
+static void sync();
 static void all();
+static void bench();
+
+// counts how many are alive, so overwriting one without destructing it shows up as a leak
+struct Livema
+{
+	static inline int64 live = 0;
+	int64 val = 0;
+
+	Livema()
+	{
+		live++;
+	}
+	Livema(int64 val)
+		: val(val)
+	{
+		live++;
+	}
+	Livema(const Livema& other)
+		: val(other.val)
+	{
+		live++;
+	}
+	Livema& operator=(const Livema& other) = default;
+	~Livema()
+	{
+		live--;
+	}
+};
 
 } // namespace test
 
@@ -130,6 +165,155 @@ static void test::memory()
 	tr::log("capacity: %zu KB, allocated: %zu KB", tr::bytes_to_kb(arena.capacity()),
 		tr::bytes_to_kb(arena.allocated()));
 
+	// resetting keeps the pages around so doing the same thing again shouldn't make new pages
+	usize capacity_before_reset = arena.capacity();
+	arena.reset();
+	(void)arena.alloc(tr::mb_to_bytes(1));
+	(void)arena.alloc(16);
+	TR_ASSERT(arena.capacity() == capacity_before_reset);
+
+	// unless you tell it not to
+	tr::Arena stingy_arena{{.max_retained_bytes = tr::kb_to_bytes(4)}};
+	TR_DEFER(stingy_arena.free());
+	(void)stingy_arena.alloc(tr::kb_to_bytes(2));
+	(void)stingy_arena.alloc(tr::kb_to_bytes(64));
+	stingy_arena.reset();
+	TR_ASSERT(stingy_arena.capacity() == tr::kb_to_bytes(4));
+
+	// reserved arenas are one big buffer that gets committed as you go
+	tr::Arena big_arena{{.page_size = tr::kb_to_bytes(64), .reserve_size = tr::gb_to_bytes(1)}};
+	TR_DEFER(big_arena.free());
+	byte* big1 = big_arena.alloc<byte*>(tr::mb_to_bytes(3));
+	byte* big2 = big_arena.alloc<byte*>(tr::mb_to_bytes(3));
+	TR_ASSERT(big2 == big1 + tr::mb_to_bytes(3));
+	big1[0] = 'm';
+	big2[tr::mb_to_bytes(3) - 1] = 'a';
+	big_arena.reset();
+	TR_ASSERT(big_arena.alloc<byte*>(16)[0] == 0);
+
+	// growing arenas get to their size in a few pages
+	tr::Arena growing_arena{{.growth_policy = tr::ArenaSettings::GrowthPolicy::DOUBLE}};
+	TR_DEFER(growing_arena.free());
+	for (usize i = 0; i < 1024; i++) {
+		(void)growing_arena.alloc(tr::kb_to_bytes(1));
+	}
+	TR_ASSERT(growing_arena.pages() <= 10);
+
+	tr::Arena callback_arena{{
+		.growth_policy = tr::ArenaSettings::GrowthPolicy::CALLBACK,
+		.grow_func = [](usize pages, usize) { return tr::kb_to_bytes(64) * (pages + 1); },
+	}};
+	TR_DEFER(callback_arena.free());
+	(void)callback_arena.alloc(16);
+	(void)callback_arena.alloc(tr::kb_to_bytes(64));
+	TR_ASSERT(callback_arena.capacity() == tr::kb_to_bytes(64 + 128));
+
+	// pages go back to the page pool when an arena is freed, so the next arena gets them again
+	tr::Arena pooled_arena{};
+	byte* pooled1 = pooled_arena.alloc<byte*>(64);
+	pooled1[0] = 'm';
+	pooled_arena.free();
+	tr::Arena pooled_arena2{};
+	TR_DEFER(pooled_arena2.free());
+	byte* pooled2 = pooled_arena2.alloc<byte*>(64);
+	TR_ASSERT(pooled1 == pooled2);
+	TR_ASSERT(pooled2[0] == 0);
+
+	// rewinding only gets rid of what came after the checkpoint
+	{
+		tr::Arena rewinder{{.page_size = tr::kb_to_bytes(8)}};
+		TR_DEFER(rewinder.free());
+
+		int64& keep = rewinder.make_ref<int64>(2);
+		tr::ArenaCheckpoint checkpoint = rewinder.checkpoint();
+		usize allocated_before = rewinder.allocated();
+
+		(void)rewinder.make_ref<MaBalls>();
+		byte* temp = rewinder.alloc<byte*>(64);
+		temp[0] = 'm';
+		(void)rewinder.alloc(tr::kb_to_bytes(16));
+		usize capacity_before = rewinder.capacity();
+
+		rewinder.rewind(checkpoint);
+		TR_ASSERT(keep == 2);
+		TR_ASSERT(rewinder.allocated() == allocated_before);
+
+		// the pages are still there
+		(void)rewinder.make_ref<MaBalls>();
+		byte* temp2 = rewinder.alloc<byte*>(64);
+		(void)rewinder.alloc(tr::kb_to_bytes(16));
+		TR_ASSERT(temp2 == temp);
+		TR_ASSERT(temp2[0] == 0);
+		TR_ASSERT(rewinder.capacity() == capacity_before);
+
+		tr::ScratchArena scratch{};
+		TR_DEFER(scratch.free());
+		(void)scratch.alloc(16);
+		tr::ArenaCheckpoint scratch_checkpoint = scratch.checkpoint();
+		byte* scratch_temp = scratch.alloc<byte*>(tr::mb_to_bytes(1));
+		scratch.rewind(scratch_checkpoint);
+		TR_ASSERT(scratch.alloc<byte*>(tr::mb_to_bytes(1)) == scratch_temp);
+	}
+
+	// arena stats, only if they're enabled
+	if constexpr (tr::ARENA_STATS) {
+		tr::Arena statma{{.name = "statma"}};
+		TR_DEFER(statma.free());
+		(void)statma.alloc(1, 1);
+		(void)statma.alloc(8, 8);
+		(void)statma.alloc(tr::kb_to_bytes(8));
+		statma.reset();
+		tr::ArenaStats stats = statma.stats();
+		TR_ASSERT(stats.requested == 9 + tr::kb_to_bytes(8));
+		TR_ASSERT(stats.padding == 7);
+		TR_ASSERT(stats.pages_made == 2);
+		TR_ASSERT(stats.fallbacks == 1);
+		TR_ASSERT(stats.resets == 1);
+		tr::log_arena_stats();
+		tr::log_arena_stats(tr::ArenaStatsFormat::JSON);
+
+		// the arenas can be in use while another thread logs them
+		tr::ScratchArena scratch{};
+		TR_DEFER(scratch.free());
+		std::thread logger([]() { tr::log_arena_stats(); });
+		for (usize i = 0; i < 1000; i++) {
+			(void)statma.alloc(16);
+			(void)scratch.alloc(16);
+		}
+		logger.join();
+		TR_ASSERT(scratch.capacity() >= tr::SCRATCH_BACKING_BUFFER_SIZE);
+	}
+
+	// pools
+	{
+		struct Entity
+		{
+			usize id;
+			float32 hp;
+		};
+
+		tr::Pool<Entity> pool{arena, 4};
+		Entity* goober = pool.make(1u, 100.0f);
+		tr::PoolHandle goober_handle = pool.handle(goober);
+		for (usize i = 0; i < 10; i++) {
+			(void)pool.make(i + 2, 50.0f);
+		}
+		TR_ASSERT(pool[goober_handle].hp == 100.0f);
+		TR_ASSERT(pool.live() == 11);
+		TR_ASSERT(pool.capacity() == 12);
+
+		// the freed slot gets reused, but the old handle knows it's not the same thing
+		pool.free(goober);
+		Entity* imposter = pool.make(67u, 25.0f);
+		TR_ASSERT(imposter == goober);
+		TR_ASSERT(!pool.try_get(goober_handle).is_valid());
+		TR_ASSERT(pool.try_get(pool.handle(imposter)).unwrap().id == 67);
+
+		pool.clear();
+		TR_ASSERT(pool.live() == 0);
+		TR_ASSERT(pool.peak() == 11);
+	}
+
 	// scratchpad arena
 	{
 		tr::ScratchArena scratch{};
@@ -167,6 +351,83 @@ static void test::memory()
 		tr::log("%c", shitfuck2[6267]);
 		TR_ASSERT(allocated_before == scratch.allocated());
 		TR_ASSERT(capacity_before = scratch.capacity());
+
+		// the memory from scratchma can be used again
+		char* shitfuck5 = scratch.alloc<char*>(tr::kb_to_bytes(256));
+		TR_ASSERT(shitfuck5[1234] == 0);
+		TR_ASSERT(scratch.capacity() == capacity_before);
+	}
+
+	// a function can put its result in a scratch arena while using another scratch arena for
+	// temporary crap
+	{
+		auto make_result = [](tr::Arena& out) -> tr::String {
+			tr::ScratchArena tmp{out};
+			TR_DEFER(tmp.free());
+			tr::String tmpstr = tr::fmt(tmp, "%s", "temporary");
+			tr::String result = tr::fmt(out, "%s and result", *tmpstr);
+			(void)tr::fmt(tmp, "more temporary crap");
+			return result;
+		};
+
+		tr::ScratchArena scratch{};
+		TR_DEFER(scratch.free());
+		tr::String result = make_result(scratch);
+
+		// if they shared the same buffer this would overwrite the result
+		tr::ScratchArena scratchma{};
+		TR_DEFER(scratchma.free());
+		(void)tr::fmt(scratchma, "OVERWRITTEN OVERWRITTEN OVERWRITTEN");
+		TR_ASSERT(result == "temporary and result");
+	}
+
+	// many threads allocating on the same arena
+	{
+		tr::ConcurrentArena concurrent{{.page_size = tr::kb_to_bytes(4)}};
+		TR_DEFER(concurrent.free());
+
+		constexpr usize THREADS = 8;
+		constexpr usize ALLOCS = 2000;
+		usize** results[THREADS] = {};
+		std::thread threads[THREADS];
+		for (usize i = 0; i < THREADS; i++) {
+			threads[i] = std::thread([&concurrent, &results, i]() {
+				results[i] = concurrent.alloc<usize**>(ALLOCS * sizeof(usize*));
+				for (usize j = 0; j < ALLOCS; j++) {
+					results[i][j] = concurrent.alloc<usize*>(sizeof(usize) * 3);
+					results[i][j][0] = i;
+					results[i][j][2] = j;
+				}
+			});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		// if 2 threads got the same memory they'd overwrite each other
+		for (usize i = 0; i < THREADS; i++) {
+			for (usize j = 0; j < ALLOCS; j++) {
+				TR_ASSERT(results[i][j][0] == i);
+				TR_ASSERT(results[i][j][1] == 0);
+				TR_ASSERT(results[i][j][2] == j);
+			}
+		}
+		TR_ASSERT(concurrent.allocated() == THREADS * ALLOCS * sizeof(usize) * 4);
+	}
+
+	// the last thing allocated can still grow in place, alignment padding and all
+	{
+		tr::ConcurrentArena concurrent{{.page_size = tr::kb_to_bytes(16)}};
+		TR_DEFER(concurrent.free());
+
+		(void)concurrent.alloc(3, 1);
+		tr::Array<int64> growma{concurrent};
+		int64* growma_buf = growma.buf();
+		for (int64 i = 0; i < 1000; i++) {
+			growma.add(i);
+		}
+		TR_ASSERT(growma.buf() == growma_buf);
+		TR_ASSERT(growma[999] == 999);
 	}
 }
 
@@ -195,6 +456,165 @@ static void test::arrays()
 	// converting from mutable to const
 	tr::Array<uint8> mut_array = {1, 2, 3};
 	tr::Array<const uint8> _ = mut_array;
+
+	// the last thing allocated can grow in place, without copying or wasting memory
+	tr::Array<int64> growma{scratch};
+	int64* growma_buf = growma.buf();
+	for (int64 i = 0; i < 1000; i++) {
+		growma.add(i);
+	}
+	TR_ASSERT(growma.buf() == growma_buf);
+	TR_ASSERT(growma[999] == 999);
+
+	// but not if something else is in the way
+	tr::StringBuilder sb{scratch, "hi"};
+	char* sb_buf = sb.buf();
+	(void)scratch.alloc(1);
+	sb.append(" this string is longer than the initial capacity");
+	TR_ASSERT(sb.buf() != sb_buf);
+	TR_ASSERT(sb == "hi this string is longer than the initial capacity");
+
+	// moving items around instead of copying them
+	struct Copyma
+	{
+		usize* copies = nullptr;
+		int64 val = 0;
+
+		Copyma() = default;
+		Copyma(usize* copies, int64 val)
+			: copies(copies)
+			, val(val)
+		{
+		}
+		Copyma(const Copyma& other)
+			: copies(other.copies)
+			, val(other.val)
+		{
+			(*copies)++;
+		}
+		Copyma(Copyma&& other) = default;
+		Copyma& operator=(const Copyma& other) = default;
+	};
+
+	usize copies = 0;
+	tr::Array<Copyma> copyma{scratch};
+	(void)scratch.alloc(1); // so it can't grow in place
+	for (int64 i = 0; i < 100; i++) {
+		copyma.emplace(&copies, i);
+	}
+	copyma.add(Copyma{&copies, 100});
+	TR_ASSERT(copies == 0);
+	TR_ASSERT(copyma[100].val == 100);
+	TR_ASSERT(copyma[37].val == 37);
+
+	// adding an item from the same array while it grows
+	tr::Array<tr::String> strs{scratch};
+	(void)scratch.alloc(1);
+	for (usize i = 0; i < 40; i++) {
+		strs.add(i == 0 ? tr::String("first") : strs[0]);
+	}
+	TR_ASSERT(strs[39] == "first");
+
+	// spans are only checked once
+	tr::Span<int64> span = growma.unchecked();
+	TR_ASSERT(span.len() == 1000);
+	int64 span_sum = 0;
+	for (int64 val : span) {
+		span_sum += val;
+	}
+	TR_ASSERT(span_sum == 999 * 1000 / 2);
+	span[5] = 55;
+	TR_ASSERT(growma[5] == 55);
+	tr::Span<const int64> const_span = span;
+	TR_ASSERT(const_span[999] == 999);
+
+	// structure of arrays
+	tr::SoaArray<tr::Vec2<float32>, float32, int64> particles{scratch};
+	for (int64 i = 0; i < 100; i++) {
+		particles.add({0, static_cast<float32>(i)}, 1.0f, i);
+	}
+	for (auto [i, pos, speed, id] : particles) {
+		pos.x += speed;
+		TR_ASSERT(id == static_cast<int64>(i));
+	}
+	TR_ASSERT(particles.get<0>(37) == tr::Vec2<float32>(1, 37));
+	TR_ASSERT(particles[37].get<3>() == 37);
+
+	// the columns are just arrays
+	auto sum_ids = [](tr::Array<const int64> ids) {
+		int64 sum = 0;
+		for (auto [_, id] : ids) {
+			sum += id;
+		}
+		return sum;
+	};
+	TR_ASSERT(sum_ids(particles.column<2>()) == 99 * 100 / 2);
+	particles.column<1>()[5] = 2.0f;
+	TR_ASSERT(particles.get<1>(5) == 2.0f);
+
+	// bucket arrays never move anything
+	tr::BucketArray<int64, 16> buckets{scratch};
+	int64& first = buckets.add(1).val;
+	for (int64 i = 2; i <= 100; i++) {
+		(void)buckets.add(i);
+	}
+	TR_ASSERT(&first == &buckets[0]);
+	TR_ASSERT(buckets[99] == 100);
+	TR_ASSERT(buckets.len() == 100);
+
+	// removing leaves a hole that gets filled later
+	buckets.remove(37);
+	TR_ASSERT(!buckets.try_get(37).is_valid());
+	int64 bucket_sum = 0;
+	for (auto [_, val] : buckets) {
+		bucket_sum += val;
+	}
+	TR_ASSERT(bucket_sum == 100 * 101 / 2 - 38);
+	auto [refilled_idx, refilled] = buckets.add(6767);
+	TR_ASSERT(refilled_idx == 37);
+	TR_ASSERT(&refilled == &buckets[37]);
+
+	// ring buffers
+	tr::RingBuffer<int64> ring{scratch, 6};
+	TR_ASSERT(ring.cap() == 8);
+	TR_ASSERT(ring.push_n(tr::Array<const int64>{1, 2, 3, 4, 5, 6}) == 6);
+	int64 popped[4] = {};
+	TR_ASSERT(ring.pop_n(tr::Array<int64>(popped, 4)) == 4);
+	TR_ASSERT(popped[3] == 4);
+	// this one wraps around
+	TR_ASSERT(ring.push_n(tr::Array<const int64>{7, 8, 9, 10, 11, 12, 13}) == 6);
+	TR_ASSERT(!ring.push_back(14));
+	auto [ring_start, ring_end] = ring.halves();
+	TR_ASSERT(ring_start.len() + ring_end.len() == 8);
+	TR_ASSERT(ring_start[0] == 5);
+	TR_ASSERT(ring_end[ring_end.len() - 1] == 12);
+	TR_ASSERT(ring.pop_back().unwrap() == 12);
+	TR_ASSERT(ring.push_front(4));
+	TR_ASSERT(ring[0] == 4);
+
+	// deques just grow
+	tr::Deque<tr::String> deque{scratch, 2};
+	deque.push_back("b");
+	deque.push_front("a");
+	deque.push_back("c");
+	deque.push_n(tr::Array<const tr::String>{"d", "e"});
+	TR_ASSERT(deque.len() == 5);
+	TR_ASSERT(deque.pop_front().unwrap() == "a");
+	TR_ASSERT(deque.pop_back().unwrap() == "e");
+	TR_ASSERT(deque[2] == "d");
+
+	// popping into items that already exist doesn't leak the old ones
+	{
+		tr::Deque<test::Livema> livema{scratch, 2};
+		for (int64 i = 0; i < 5; i++) {
+			livema.push_back(test::Livema{i});
+		}
+		test::Livema out[3];
+		TR_ASSERT(livema.pop_n(tr::Array<test::Livema>(out, 3)) == 3);
+		TR_ASSERT(out[2].val == 2);
+		livema.clear();
+	}
+	TR_ASSERT(test::Livema::live == 0);
 }
 
 static void test::strings()
@@ -217,6 +637,27 @@ static void test::strings()
 	TR_ASSERT(str.substr(scratch, 1, 3) == "igm");
 	tr::Array<usize> sigma = tr::String("sigmysigmy").find(scratch, "ig");
 	TR_ASSERT(sigma.len() == 2);
+	// the whole match has to be before the end
+	TR_ASSERT(tr::String("sigmysigmy").find(scratch, "ig", 0, 6).len() == 1);
+	TR_ASSERT(tr::String("sigmysigmy").find(scratch, "ig", 0, 8).len() == 2);
+	TR_ASSERT(tr::String("sigmysigmy").find(scratch, 'g', 3).len() == 1);
+
+	// long enough for the SIMD crap, with matches on both sides of a block
+	tr::StringBuilder haystack{scratch, ""};
+	for (usize i = 0; i < 100; i++) {
+		haystack.append(i == 31 || i == 77 ? "needle" : "neeedle");
+	}
+	tr::String hay = haystack;
+	TR_ASSERT(hay.find_first("needle").unwrap() == 31 * 7);
+	TR_ASSERT(hay.find_next("needle", 31 * 7).unwrap() == 77 * 7 - 1);
+	TR_ASSERT(hay.find_next("needle", 77 * 7 - 1).is_invalid());
+	TR_ASSERT(hay.find(scratch, "needle").len() == 2);
+	TR_ASSERT(hay.find_first("needles").is_invalid());
+	TR_ASSERT(hay.find_first('d', 0).unwrap() == 4);
+	TR_ASSERT(hay.find_next('d', 4).unwrap() == 11);
+	TR_ASSERT(hay.find_first('x').is_invalid());
+	TR_ASSERT(hay.find(scratch, 'n').len() == 100);
+	TR_ASSERT(hay.find_first('e', hay.len()).is_invalid());
 	tr::String sigmaa = tr::String("figma").concat(scratch, " balls");
 	TR_ASSERT(sigmaa == "figma balls");
 	TR_ASSERT(sigmaa.starts_with("figm"));
@@ -238,6 +679,41 @@ static void test::strings()
 	TR_ASSERT(splitma[1] == "shit");
 	TR_ASSERT(splitma[2] == "fuck");
 	TR_ASSERT(splitma[3] == "balls");
+	TR_ASSERT(std::strlen(*splitma[1]) == 4);
+	TR_ASSERT(tr::String("a/b/").split(scratch, '/').len() == 3);
+
+	// views don't copy crap
+	tr::StrView csv = "  name, hp ,,mana\n";
+	tr::StrView line = csv.trim();
+	TR_ASSERT(line == "name, hp ,,mana");
+	TR_ASSERT(line.buf() == csv.buf() + 2);
+	TR_ASSERT(line.slice(5, 9) == " hp ");
+	TR_ASSERT(line.slice(5, 9).trim() == "hp");
+	TR_ASSERT(line.slice(10) == ",mana");
+	TR_ASSERT(line.slice(11, 2).len() == 0);
+	TR_ASSERT(line.find_first(',').unwrap() == 4);
+	TR_ASSERT(line.find_next(',', 4).unwrap() == 9);
+	TR_ASSERT(line.find_first("mana").unwrap() == 11);
+	TR_ASSERT(line.starts_with("name") && line.ends_with("mana") && !line.ends_with("manaa"));
+
+	tr::StrView fields[] = {"name", "hp", "", "mana"};
+	usize field_count = 0;
+	for (tr::StrView field : line.split_iter(',')) {
+		TR_ASSERT(field_count < 4 && field.trim() == fields[field_count]);
+		TR_ASSERT(field.buf() >= line.buf() && field.buf() <= line.buf() + line.len());
+		field_count++;
+	}
+	TR_ASSERT(field_count == 4);
+	field_count = 0;
+	for (tr::StrView field : tr::StrView{"a,"}.split_iter(',')) {
+		TR_ASSERT(field == (field_count == 0 ? "a" : ""));
+		field_count++;
+	}
+	TR_ASSERT(field_count == 2);
+
+	tr::String hp = line.slice(5, 9).trim().to_string(scratch);
+	TR_ASSERT(hp == "hp" && std::strlen(*hp) == 2);
+	TR_ASSERT(tr::StrView{str} == "sigma");
 
 	TR_ASSERT(
 		tr::String("sigma\\sigma\\on\\the\\wall").replace(scratch, '\\', '/') ==
@@ -315,6 +791,187 @@ static void test::hashmaps()
 		tr::log("hashmaballs[%s] = \"%s\"", *key, *value);
 	}
 	tr::log("length %zu, capacity %zu", hashmaballs.len(), hashmaballs.cap());
+
+	// enough to grow a few times and fill a bunch of groups
+	tr::HashMap<int64, int64> squares{scratch};
+	for (int64 i = 0; i < 10'000; i++) {
+		squares[i] = i * i;
+	}
+	for (int64 i = 0; i < 10'000; i += 2) {
+		TR_ASSERT(squares.remove(i));
+	}
+	TR_ASSERT(squares.len() == 5'000);
+	TR_ASSERT((squares.cap() & (squares.cap() - 1)) == 0);
+	TR_ASSERT(!squares.contains(5'000));
+	TR_ASSERT(squares.try_get(5'001).unwrap() == 5'001 * 5'001);
+	usize squares_found = 0;
+	for (auto [key, value] : squares) {
+		TR_ASSERT(key % 2 == 1 && value == key * key);
+		squares_found++;
+	}
+	TR_ASSERT(squares_found == 5'000);
+
+	usize old_cap = squares.cap();
+	squares.shrink_to_fit();
+	TR_ASSERT(squares.cap() < old_cap);
+	TR_ASSERT(squares.try_get(9'999).unwrap() == 9'999 * 9'999);
+
+	// a cache that keeps replacing its keys shouldn't grow forever
+	tr::HashMap<int64, int64> churn{scratch};
+	for (int64 i = 0; i < 100'000; i++) {
+		churn[i] = i;
+		if (i >= 100) {
+			TR_ASSERT(churn.remove(i - 100));
+		}
+	}
+	TR_ASSERT(churn.len() == 100);
+	TR_ASSERT(churn.cap() == 256);
+	TR_ASSERT(churn.contains(99'999) && !churn.contains(99'899));
+
+	// growing incrementally, everything has to be findable while it's halfway there
+	tr::HashMapSettings<int64> incremental_settings = {
+		.load_factor = 0.875,
+		.initial_capacity = 16,
+		.hash_func = tr::_default_hash_function,
+		.incremental_rehash = true,
+	};
+	tr::HashMap<int64, int64> incremental{scratch, incremental_settings};
+	for (int64 i = 0; i < 10'000; i++) {
+		incremental[i] = i * 3;
+		// only odd keys stay
+		if (i % 2 == 1) {
+			TR_ASSERT(incremental.remove(i - 1));
+		}
+		TR_ASSERT(incremental.contains(i / 2) == ((i / 2) % 2 == 1 || i == 0));
+	}
+	usize incremental_found = 0;
+	for (auto [key, value] : incremental) {
+		TR_ASSERT(key % 2 == 1 && value == key * 3);
+		incremental_found++;
+	}
+	TR_ASSERT(incremental.len() == 5'000 && incremental_found == 5'000);
+
+	// removing while it's moving things makes tombstones in the new table, which the move then
+	// reuses. if they're still counted it grows before it's actually full. everything
+	// collides so the groups are full and removing has to leave tombstones
+	tr::HashMapSettings<int64> collide_settings = incremental_settings;
+	collide_settings.initial_capacity = 256;
+	collide_settings.hash_func = [](const int64&) -> uint64 { return 0; };
+	tr::HashMap<int64, int64> collide{scratch, collide_settings};
+	for (int64 i = 0; i < 225; i++) {
+		collide[i] = i;
+	}
+	TR_ASSERT(collide.cap() == 512);
+	for (int64 i = 0; i < 8; i++) {
+		TR_ASSERT(collide.remove(i));
+		collide[1'000 + i] = i;
+	}
+	for (int64 i = 2'000; collide.len() < 447; i++) {
+		collide[i] = i;
+	}
+	TR_ASSERT(collide.cap() == 512);
+
+	// presizing
+	tr::HashMap<int64, int64> presized{scratch};
+	presized.reserve(1'000);
+	usize presized_cap = presized.cap();
+	for (int64 i = 0; i < 1'000; i++) {
+		presized[i] = i;
+	}
+	TR_ASSERT(presized.cap() == presized_cap);
+
+	tr::Pair<int64, tr::String> pairs[] = {{1, "one"}, {2, "two"}, {1, "uno"}};
+	auto from_array = tr::HashMap<int64, tr::String>::from_array(
+		scratch, tr::Array<const tr::Pair<int64, tr::String>>(pairs, 3)
+	);
+	TR_ASSERT(from_array.len() == 2);
+	TR_ASSERT(from_array[1] == "uno" && from_array[2] == "two");
+
+	// looking up without making a tr::String first
+	const char* sigma = "Sigma";
+	tr::StringBuilder sigma_builder{scratch, "Sig"};
+	sigma_builder.append("ma");
+	TR_ASSERT(hashma.contains(sigma));
+	TR_ASSERT(hashma.try_get(sigma_builder).unwrap() == "balls!");
+	TR_ASSERT(!hashma.contains(tr::StringBuilder{scratch, "Balls"}));
+	TR_ASSERT(hashma.find_with_hash(sigma, hashma.hash_key("Sigma")).unwrap() == "balls!");
+
+	usize made = 0;
+	auto make = [&]() -> tr::String {
+		made++;
+		return "ball";
+	};
+	TR_ASSERT(hashma.get_or_insert_with("Ball", make) == "ball");
+	TR_ASSERT(hashma.get_or_insert_with("Ball", make) == "ball");
+	TR_ASSERT(made == 1);
+	TR_ASSERT(hashma.remove(tr::StringBuilder{scratch, "Ball"}));
+
+	// same thing with a custom hash, which can't use tr::HashLookup
+	tr::HashMapSettings<tr::String> custom_settings = {
+		.load_factor = 0.875,
+		.initial_capacity = 16,
+		.hash_func = [](const tr::String& key) -> uint64 { return key.len() * 31; },
+	};
+	tr::HashMap<tr::String, int64> custom{scratch, custom_settings};
+	custom["Sigma"] = 1;
+	tr::HashSet<tr::String> custom_set{scratch, custom_settings};
+	TR_ASSERT(custom_set.add("Sigma"));
+	TR_ASSERT(custom.contains(sigma) && custom.try_get(sigma_builder).unwrap() == 1);
+	TR_ASSERT(custom_set.contains(sigma_builder));
+	TR_ASSERT(custom.remove(sigma) && custom_set.remove(sigma));
+
+	// sets
+	tr::HashSet<int64> evens{scratch};
+	tr::HashSet<int64> threes{scratch};
+	for (int64 i = 0; i < 300; i += 2) {
+		TR_ASSERT(evens.add(i));
+	}
+	TR_ASSERT(!evens.add(0));
+	tr::Array<int64> multiples{scratch, 100};
+	for (auto [i, val] : multiples) {
+		val = static_cast<int64>(i) * 3;
+	}
+	TR_ASSERT(threes.insert_all(multiples) == 100);
+	TR_ASSERT(threes.insert_all(multiples) == 0);
+	TR_ASSERT(evens.unite(scratch, threes).len() == 150 + 100 - 50);
+	TR_ASSERT(evens.intersect(scratch, threes).len() == 50);
+	tr::HashSet<int64> odd_threes = threes.difference(scratch, evens);
+	TR_ASSERT(odd_threes.len() == 50 && odd_threes.contains(3) && !odd_threes.contains(6));
+
+	tr::HashSet<tr::String> names{scratch};
+	names.add("john");
+	TR_ASSERT(names.contains(sigma) == false && names.contains("john"));
+
+	// flat maps stay sorted
+	tr::FlatMap<int64, tr::String> flatma{scratch, 2};
+	flatma[3] = "three";
+	flatma[1] = "one";
+	flatma[2] = "two";
+	flatma[0] = "zero";
+	TR_ASSERT(flatma.remove(2) && !flatma.remove(2));
+	TR_ASSERT(flatma.len() == 3 && flatma.keys()[2] == 3);
+	TR_ASSERT(flatma.try_get(1).unwrap() == "one" && !flatma.contains(2));
+	for (auto [key, value] : flatma) {
+		tr::log("flatma[%li] = \"%s\"", key, *value);
+	}
+
+	// test vectors from the wyhash repo
+	auto wyhash = [](const char* str, uint64 seed) {
+		return tr::hash(reinterpret_cast<const uint8*>(str), strlen(str), seed);
+	};
+	TR_ASSERT(wyhash("", 0) == 0x93228a4de0eec5a2);
+	TR_ASSERT(wyhash("abc", 2) == 0xa97f2f7b1d9b3314);
+	TR_ASSERT(wyhash("abcdefghijklmnopqrstuvwxyz", 4) == 0xdca5a8138ad37c87);
+	TR_ASSERT(
+		wyhash("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789", 5) ==
+		0xb9e734f117cfaf70
+	);
+	TR_ASSERT(
+		wyhash("1234567890123456789012345678901234567890123456789012345678901234567890"
+		       "1234567890",
+		       6) == 0x6cc5eab49a92d617
+	);
+	TR_ASSERT(tr::hash_fnv1a(reinterpret_cast<const uint8*>("a"), 1) == 0xaf63dc4c8601ec8c);
 }
 
 static void test::filesystem()
@@ -370,6 +1027,185 @@ static void test::filesystem()
 	tr::create_dir(tr::path(scratch, "user://")).unwrap();
 }
 
+static void test::sync()
+{
+	tr::log("\n==== SYNC ====");
+
+	tr::Arena arena{};
+	TR_DEFER(arena.free());
+
+	constexpr usize ITEMS = 100'000;
+
+	// 1 producer 1 consumer
+	{
+		tr::SpscQueue<usize> queue{arena, 100};
+		TR_ASSERT(queue.cap() == 128);
+
+		std::thread producer([&queue]() {
+			usize batch[16] = {};
+			for (usize i = 0; i < ITEMS;) {
+				// sometimes 1 at a time, sometimes a bunch at a time
+				if (i % 3 == 0) {
+					if (queue.push(i)) {
+						i++;
+					}
+					else {
+						std::this_thread::yield();
+					}
+					continue;
+				}
+
+				usize n = tr::min(usize{16}, ITEMS - i);
+				for (usize j = 0; j < n; j++) {
+					batch[j] = i + j;
+				}
+				i += queue.push_n(tr::Array<const usize>(batch, n));
+			}
+		});
+
+		// it should come out in the same order
+		usize expected = 0;
+		usize out[32] = {};
+		while (expected < ITEMS) {
+			usize n = queue.pop_n(tr::Array<usize>(out, 32));
+			if (n == 0) {
+				std::this_thread::yield();
+			}
+			for (usize i = 0; i < n; i++) {
+				TR_ASSERT(out[i] == expected);
+				expected++;
+			}
+		}
+		producer.join();
+		TR_ASSERT(!queue.pop().is_valid());
+	}
+
+	// many producers many consumers
+	{
+		constexpr usize THREADS = 4;
+		tr::MpmcQueue<usize> queue{arena, 256};
+		std::atomic<usize> popped = 0;
+		std::atomic<usize> sum = 0;
+
+		std::thread producers[THREADS];
+		std::thread consumers[THREADS];
+		for (usize t = 0; t < THREADS; t++) {
+			producers[t] = std::thread([&queue, t]() {
+				usize batch[8] = {};
+				for (usize i = t; i < ITEMS;) {
+					if ((i / THREADS) % 2 == 0) {
+						if (queue.push(i)) {
+							i += THREADS;
+						}
+						else {
+							std::this_thread::yield();
+						}
+						continue;
+					}
+
+					usize n = 0;
+					for (usize j = i; j < ITEMS && n < 8; j += THREADS) {
+						batch[n++] = j;
+					}
+					tr::Array<const usize> batch_array{batch, n};
+					i += queue.push_n(batch_array) * THREADS;
+				}
+			});
+
+			consumers[t] = std::thread([&queue, &popped, &sum]() {
+				usize out[8] = {};
+				while (popped.load() < ITEMS) {
+					usize n = queue.pop_n(tr::Array<usize>(out, 8));
+					if (n == 0) {
+						std::this_thread::yield();
+					}
+					for (usize i = 0; i < n; i++) {
+						sum += out[i];
+					}
+					popped += n;
+				}
+			});
+		}
+		for (usize t = 0; t < THREADS; t++) {
+			producers[t].join();
+			consumers[t].join();
+		}
+
+		// if something got lost or duplicated the sum would be wrong
+		TR_ASSERT(popped == ITEMS);
+		TR_ASSERT(sum == (ITEMS - 1) * ITEMS / 2);
+	}
+
+	// popping into items that already exist doesn't leak the old ones
+	{
+		tr::SpscQueue<test::Livema> spsc{arena, 4};
+		tr::MpmcQueue<test::Livema> mpmc{arena, 4};
+		for (int64 i = 0; i < 3; i++) {
+			TR_ASSERT(spsc.push(test::Livema{i}));
+			TR_ASSERT(mpmc.push(test::Livema{i}));
+		}
+		test::Livema out[3];
+		TR_ASSERT(spsc.pop_n(tr::Array<test::Livema>(out, 3)) == 3);
+		TR_ASSERT(out[2].val == 2);
+		TR_ASSERT(mpmc.pop_n(tr::Array<test::Livema>(out, 3)) == 3);
+		TR_ASSERT(out[1].val == 1);
+	}
+	TR_ASSERT(test::Livema::live == 0);
+
+	// concurrent hashmap
+	{
+		constexpr usize THREADS = 4;
+		constexpr usize KEYS = 10'000;
+		tr::ConcurrentArena map_arena{};
+		TR_DEFER(map_arena.free());
+		tr::ConcurrentHashMap<usize, usize> map{map_arena};
+
+		// writers all fight over the same keys, readers check whatever's there so far
+		std::thread writers[THREADS];
+		std::thread readers[THREADS];
+		for (usize t = 0; t < THREADS; t++) {
+			writers[t] = std::thread([&map, t]() {
+				for (usize i = 0; i < KEYS; i++) {
+					usize key = (i + t * KEYS / THREADS) % KEYS;
+					if (!map.insert(key, key * 2)) {
+						map.update(key, [](usize& val) { val++; });
+					}
+				}
+			});
+
+			readers[t] = std::thread([&map]() {
+				for (usize i = 0; i < KEYS; i++) {
+					tr::Maybe<usize> val = map.get(i);
+					if (val.is_valid()) {
+						usize v = val.unwrap();
+						TR_ASSERT(v >= i * 2 && v < i * 2 + THREADS);
+					}
+				}
+			});
+		}
+		for (usize t = 0; t < THREADS; t++) {
+			writers[t].join();
+			readers[t].join();
+		}
+
+		// every key got inserted once and updated by everyone else
+		TR_ASSERT(map.len() == KEYS);
+		usize sum = 0;
+		map.for_each([&sum](usize key, usize val) {
+			TR_ASSERT(val == key * 2 + THREADS - 1);
+			sum += key;
+		});
+		TR_ASSERT(sum == (KEYS - 1) * KEYS / 2);
+
+		TR_ASSERT(map.remove(42));
+		TR_ASSERT(!map.contains(42));
+		TR_ASSERT(map.set(42, 1));
+		TR_ASSERT(!map.set(42, 2));
+		TR_ASSERT(map.get_or_insert_with(42, []() { return usize{3}; }) == 2);
+		TR_ASSERT(map.get_or_insert_with(KEYS, []() { return usize{3}; }) == 3);
+	}
+}
+
 static void test::all()
 {
 	test::logging();
@@ -379,6 +1215,256 @@ static void test::all()
 	test::strings();
 	test::hashmaps();
 	test::filesystem();
+	test::sync();
+}
+
+// not part of --all since it takes a while and it's only useful with optimizations on
+static void test::bench()
+{
+	tr::log("\n==== BENCHMARKS ====");
+
+	tr::Arena arena{};
+	TR_DEFER(arena.free());
+
+	constexpr usize LEN = 10'000'000;
+	constexpr usize RUNS = 10;
+	tr::Array<int64> array{arena, LEN};
+	for (auto [i, val] : array) {
+		val = static_cast<int64>(i);
+	}
+
+	int64 sum = 0;
+	auto bench = [&](const char* label, auto func) {
+		tr::Stopwatch stopwatch{};
+		stopwatch.start();
+		for (usize run = 0; run < RUNS; run++) {
+			sum += func(array);
+		}
+		stopwatch.stop();
+		stopwatch.print_time_ms(label);
+	};
+
+	bench("array[i]", [](tr::Array<int64> arr) {
+		int64 result = 0;
+		for (usize i = 0; i < arr.len(); i++) {
+			result += arr[i];
+		}
+		return result;
+	});
+	bench("for (auto [i, val] : array)", [](tr::Array<int64> arr) {
+		int64 result = 0;
+		for (auto [_, val] : arr) {
+			result += val;
+		}
+		return result;
+	});
+	bench("span[i]", [](tr::Array<int64> arr) {
+		tr::Span<int64> span = arr.unchecked();
+		int64 result = 0;
+		for (usize i = 0; i < span.len(); i++) {
+			result += span[i];
+		}
+		return result;
+	});
+	bench("for (int64 val : span)", [](tr::Array<int64> arr) {
+		int64 result = 0;
+		for (int64 val : arr.unchecked()) {
+			result += val;
+		}
+		return result;
+	});
+	bench("raw pointer", [](tr::Array<int64> arr) {
+		int64* ptr = arr.buf();
+		usize len = arr.len();
+		int64 result = 0;
+		for (usize i = 0; i < len; i++) {
+			result += ptr[i];
+		}
+		return result;
+	});
+
+	// so the compiler doesn't optimize it all away
+	constexpr int64 EXPECTED = static_cast<int64>((LEN - 1) * LEN / 2 * RUNS * 5);
+	TR_ASSERT(sum == EXPECTED);
+
+	// queues against the classic mutex + array combo
+	constexpr usize ITEMS = 1'000'000;
+	auto bench_threads = [&](const char* label, usize threads, auto push, auto pop) {
+		std::atomic<usize> popped = 0;
+		std::thread producers[4];
+		std::thread consumers[4];
+
+		tr::Stopwatch stopwatch{};
+		stopwatch.start();
+		for (usize t = 0; t < threads; t++) {
+			producers[t] = std::thread([&push, threads]() {
+				for (usize i = 0; i < ITEMS / threads; i++) {
+					// yielding so it doesn't take forever on computers with few
+					// cores
+					while (!push(i)) {
+						std::this_thread::yield();
+					}
+				}
+			});
+			consumers[t] = std::thread([&pop, &popped]() {
+				while (popped.load(std::memory_order_relaxed) < ITEMS) {
+					if (pop()) {
+						popped.fetch_add(1, std::memory_order_relaxed);
+					}
+					else {
+						std::this_thread::yield();
+					}
+				}
+			});
+		}
+		for (usize t = 0; t < threads; t++) {
+			producers[t].join();
+			consumers[t].join();
+		}
+		stopwatch.stop();
+		stopwatch.print_time_ms(label);
+	};
+
+	std::mutex mutex;
+	tr::Array<usize> mutex_array{arena};
+	usize mutex_read = 0;
+	auto mutex_push = [&](usize val) {
+		std::lock_guard<std::mutex> lock{mutex};
+		mutex_array.add(val);
+		return true;
+	};
+	auto mutex_pop = [&]() {
+		std::lock_guard<std::mutex> lock{mutex};
+		if (mutex_read < mutex_array.len()) {
+			mutex_read++;
+			return true;
+		}
+		return false;
+	};
+	bench_threads("mutex + array (1 producer, 1 consumer)", 1, mutex_push, mutex_pop);
+
+	tr::SpscQueue<usize> spsc{arena, 1024};
+	bench_threads(
+		"tr::SpscQueue<T> (1 producer, 1 consumer)", 1,
+		[&](usize val) { return spsc.push(val); }, [&]() { return spsc.pop().is_valid(); }
+	);
+
+	mutex_array.clear(tr::ArrayClearBehavior::DO_NOTHING);
+	mutex_read = 0;
+	bench_threads("mutex + array (4 producers, 4 consumers)", 4, mutex_push, mutex_pop);
+
+	tr::MpmcQueue<usize> mpmc{arena, 1024};
+	bench_threads(
+		"tr::MpmcQueue<T> (4 producers, 4 consumers)", 4,
+		[&](usize val) { return mpmc.push(val); }, [&]() { return mpmc.pop().is_valid(); }
+	);
+
+	// hash throughput, for long and short keys
+	tr::Array<uint8> bytes{arena, 64 * 1024 * 1024};
+	for (auto [i, byte] : bytes) {
+		byte = static_cast<uint8>(i * 31);
+	}
+	uint64 hash_sum = 0;
+	auto bench_hash = [&](const char* label, usize key_len, auto func) {
+		tr::Stopwatch stopwatch{};
+		stopwatch.start();
+		for (usize i = 0; i + key_len <= bytes.len(); i += key_len) {
+			hash_sum += func(bytes.buf() + i, key_len);
+		}
+		stopwatch.stop();
+		stopwatch.print_time_ms(label);
+	};
+	bench_hash("tr::hash_fnv1a() (64 MB in 1 MB keys)", 1024 * 1024, tr::hash_fnv1a);
+	bench_hash("tr::hash() (64 MB in 1 MB keys)", 1024 * 1024, [](const uint8* b, usize l) {
+		return tr::hash(b, l);
+	});
+	bench_hash("tr::hash_fnv1a() (64 MB in 16 byte keys)", 16, tr::hash_fnv1a);
+	bench_hash("tr::hash() (64 MB in 16 byte keys)", 16, [](const uint8* b, usize l) {
+		return tr::hash(b, l);
+	});
+	tr::log("(hash sum %llu)", static_cast<unsigned long long>(hash_sum));
+
+	// hash quality: flipping 1 bit of the key should flip half the bits of the hash
+	auto avalanche = [](const char* label, auto func) {
+		usize flipped = 0;
+		usize tries = 0;
+		for (uint64 key = 0; key < 10'000; key++) {
+			uint64 hash = func(key);
+			for (usize bit = 0; bit < 64; bit++) {
+				flipped += std::popcount(hash ^ func(key ^ (uint64{1} << bit)));
+				tries++;
+			}
+		}
+		float64 avg = static_cast<float64>(flipped) / static_cast<float64>(tries);
+		tr::log("%s: %.2f bits flipped on average (32 is perfect)", label, avg);
+	};
+	avalanche("tr::hash_fnv1a() on integers", [](uint64 key) {
+		return tr::hash_fnv1a(reinterpret_cast<const uint8*>(&key), sizeof(key));
+	});
+	avalanche("tr::hash() on integers", [](uint64 key) {
+		return tr::hash(reinterpret_cast<const uint8*>(&key), sizeof(key));
+	});
+	avalanche("tr::hash_int()", [](uint64 key) { return tr::hash_int(key); });
+
+	// searching a big string for something that isn't there, the scalar loops are how
+	// String::find() used to work
+	tr::Array<char> text_buf{arena, 64 * 1024 * 1024};
+	for (auto [i, c] : text_buf) {
+		c = static_cast<char>('a' + i % 23);
+	}
+	text_buf[text_buf.len() - 1] = '\0';
+	tr::String text{text_buf.buf(), text_buf.len()};
+	usize found = 0;
+	auto bench_find = [&](const char* label, auto func) {
+		tr::Stopwatch stopwatch{};
+		stopwatch.start();
+		found += func();
+		stopwatch.stop();
+		stopwatch.print_time_ms(label);
+	};
+	bench_find("byte loop (64 MB)", [&]() {
+		usize n = 0;
+		for (usize i = 0; i < text.len(); i++) {
+			n += text.buf()[i] == '#';
+		}
+		return n;
+	});
+	bench_find("tr::String::find_first(char) (64 MB)", [&]() {
+		return text.find_first('#').is_valid();
+	});
+	bench_find("memcmp at every byte (64 MB)", [&]() {
+		usize n = 0;
+		for (usize i = 0; i + 6 <= text.len(); i++) {
+			n += std::memcmp(text.buf() + i, "needle", 6) == 0;
+		}
+		return n;
+	});
+	bench_find("tr::String::find_first(String) (64 MB)", [&]() {
+		return text.find_first("needle").is_valid();
+	});
+	tr::log("(found %zu)", found);
+
+	// the slowest insert, which is usually the one that has to grow
+	auto worst_insert = [&](const char* label, bool incremental) {
+		tr::HashMapSettings<int64> settings = {
+			.load_factor = 0.875,
+			.initial_capacity = 16,
+			.hash_func = tr::_default_hash_function,
+			.incremental_rehash = incremental,
+		};
+		tr::HashMap<int64, int64> map{arena, settings};
+		int64 worst_us = 0;
+		tr::Stopwatch stopwatch{};
+		for (int64 i = 0; i < 4'000'000; i++) {
+			stopwatch.start();
+			map[i] = i;
+			stopwatch.stop();
+			worst_us = tr::max(worst_us, stopwatch.elapsed_us());
+		}
+		tr::log("%s: %lld us", label, static_cast<long long>(worst_us));
+	};
+	worst_insert("slowest tr::HashMap insert (4M keys)", false);
+	worst_insert("slowest tr::HashMap insert (4M keys, incremental rehash)", true);
 }
 
 int main(int argc, char* argv[])
@@ -410,9 +1496,15 @@ int main(int argc, char* argv[])
 		else if (arg == "--filesystem") {
 			test::filesystem();
 		}
+		else if (arg == "--sync") {
+			test::sync();
+		}
 		else if (arg == "--all") {
 			test::all();
 		}
+		else if (arg == "--bench") {
+			test::bench();
+		}
 		else {
 			printf("The libtrippin tester 5000™\n");
 			printf("Options:\n");
@@ -423,7 +1515,9 @@ int main(int argc, char* argv[])
 			printf("- --string:      Test strings\n");
 			printf("- --hashmap:     Test hashmaps\n");
 			printf("- --filesystem:  Test filesystem\n");
+			printf("- --sync:        Test sync\n");
 			printf("- --all:         Test everything\n");
+			printf("- --bench:       Run benchmarks\n");
 		}
 	}
 	else {
@@ -0,0 +1,277 @@
+/*
+ * libtrippin: Most massive library of all time
+ * https://github.com/hellory4n/libtrippin
+ *
+ * trippin/bits/pagepool.cpp
+ * Global page pool so arenas don't have to malloc/free every page
+ *
+ * Copyright (C) 2025 by hellory4n <hellory4n@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this
+ * software for any purpose with or without fee is hereby
+ * granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS
+ * ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE
+ * USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include "trippin/common.h"
+#include "trippin/memory.h"
+
+// how it works: each thread has a magazine of pages for every size class, which is just a linked
+// list so taking and giving back pages is free. when a magazine gets too full half of it goes to
+// the global pool as a batch, and when it's empty it takes a batch from the global pool. the
+// global pool is a lock-free stack of batches.
+//
+// pages in a magazine are linked through `next`. in the global pool, pages in a batch are linked
+// through `next` and batches are linked through the first page's `prev`.
+
+namespace tr {
+
+namespace _tr {
+	// 4 KB, 8 KB, 16 KB, ..., 1 MB
+	constexpr usize PAGE_POOL_CLASSES = 9;
+	static_assert(PAGE_POOL_MIN_PAGE << (PAGE_POOL_CLASSES - 1) == PAGE_POOL_MAX_PAGE);
+
+	// how many bytes worth of pages of each size class a thread keeps for itself
+	constexpr usize PAGE_MAGAZINE_BYTES = tr::mb_to_bytes(1);
+
+	struct PageMagazine
+	{
+		ArenaPage* pages[PAGE_POOL_CLASSES] = {};
+		usize count[PAGE_POOL_CLASSES] = {};
+
+		// thread_local destructors are the only way to find out a thread died, so this is
+		// one of the few places where RAII is the lesser evil
+		~PageMagazine();
+	};
+
+	// everything's zero so this is initialized before any constructor runs
+	static std::atomic<ArenaPage*> page_pool[PAGE_POOL_CLASSES];
+	static std::atomic<usize> page_pool_bytes;
+
+	static thread_local PageMagazine page_magazine;
+	// arenas can be freed after the magazine is dead (e.g. global arenas at exit), in which
+	// case pages go straight to the global pool
+	static thread_local bool page_magazine_dead = false;
+
+	// returns the size class for that page size, or -1 if it doesn't go in the pool
+	static isize page_pool_class(usize size)
+	{
+		if (size < PAGE_POOL_MIN_PAGE || size > PAGE_POOL_MAX_PAGE) {
+			return -1;
+		}
+		if ((size & (size - 1)) != 0) {
+			return -1;
+		}
+
+		isize cls = 0;
+		while ((PAGE_POOL_MIN_PAGE << cls) != size) {
+			cls++;
+		}
+		return cls;
+	}
+
+	static usize page_magazine_capacity(usize cls)
+	{
+		usize pages = PAGE_MAGAZINE_BYTES / (PAGE_POOL_MIN_PAGE << cls);
+		return tr::clamp(pages, usize{2}, usize{64});
+	}
+
+	// actually frees a chain of pages linked through `next`
+	static void free_page_chain(ArenaPage* page)
+	{
+		while (page != nullptr) {
+			ArenaPage* next = page->next;
+			page->free();
+			std::free(page);
+			page = next;
+		}
+	}
+
+	// gives a batch of pages (linked through `next`) to the global pool
+	static void push_page_batch(usize cls, ArenaPage* batch, usize count)
+	{
+		usize bytes = count * (PAGE_POOL_MIN_PAGE << cls);
+		// it can go a bit over if several threads do this at the same time, it's fine
+		if (page_pool_bytes.load(std::memory_order_relaxed) + bytes > PAGE_POOL_MAX_BYTES) {
+			free_page_chain(batch);
+			return;
+		}
+		page_pool_bytes.fetch_add(bytes, std::memory_order_relaxed);
+
+		batch->prev = page_pool[cls].load(std::memory_order_relaxed);
+		while (!page_pool[cls].compare_exchange_weak(
+			batch->prev, batch, std::memory_order_release, std::memory_order_relaxed
+		)) {
+		}
+	}
+
+	// takes a batch of pages from the global pool, returns null if there's nothing there. the
+	// count of the batch is put in `out_count`
+	static ArenaPage* pop_page_batch(usize cls, usize& out_count)
+	{
+		// popping a single batch with a CAS has the ABA problem, taking everything doesn't.
+		// then we just put back what we didn't want
+		ArenaPage* batches = page_pool[cls].exchange(nullptr, std::memory_order_acquire);
+		if (batches == nullptr) {
+			return nullptr;
+		}
+
+		ArenaPage* rest = batches->prev;
+		if (rest != nullptr) {
+			ArenaPage* rest_tail = rest;
+			while (rest_tail->prev != nullptr) {
+				rest_tail = rest_tail->prev;
+			}
+
+			rest_tail->prev = page_pool[cls].load(std::memory_order_relaxed);
+			while (!page_pool[cls].compare_exchange_weak(
+				rest_tail->prev, rest, std::memory_order_release,
+				std::memory_order_relaxed
+			)) {
+			}
+		}
+
+		out_count = 0;
+		for (ArenaPage* page = batches; page != nullptr; page = page->next) {
+			out_count++;
+		}
+		usize bytes = out_count * (PAGE_POOL_MIN_PAGE << cls);
+		page_pool_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+		batches->prev = nullptr;
+		return batches;
+	}
+
+	static bool page_pool_usable(const ArenaSettings& settings)
+	{
+		return settings.use_page_pool && !settings.reserve_size.is_valid();
+	}
+
+	// arenas should use this size for new pages, so they can go in the pool
+	static usize page_pool_size(const ArenaSettings& settings, usize size)
+	{
+		if (!page_pool_usable(settings) || size > PAGE_POOL_MAX_PAGE) {
+			return size;
+		}
+
+		usize class_size = PAGE_POOL_MIN_PAGE;
+		while (class_size < size) {
+			class_size <<= 1;
+		}
+		return class_size;
+	}
+
+	// makes a page, from the page pool if possible. returns null if it couldn't make one and
+	// the settings say not to panic
+	static ArenaPage* new_arena_page(const ArenaSettings& settings, usize size)
+	{
+		isize cls = page_pool_usable(settings) ? page_pool_class(size) : -1;
+		if (cls != -1) {
+			ArenaPage* page = nullptr;
+			if (!page_magazine_dead) {
+				if (page_magazine.pages[cls] == nullptr) {
+					usize count = 0;
+					page_magazine.pages[cls] = pop_page_batch(cls, count);
+					page_magazine.count[cls] = count;
+				}
+
+				page = page_magazine.pages[cls];
+				if (page != nullptr) {
+					page_magazine.pages[cls] = page->next;
+					page_magazine.count[cls]--;
+				}
+			}
+
+			if (page != nullptr) {
+				// whoever had it before could've left anything in there
+				if (settings.zero_initialize) {
+					TR_ASAN_UNPOISON_MEMORY(page->buffer, page->bufsize);
+					std::memset(page->buffer, 0, page->bufsize);
+					TR_ASAN_POISON_MEMORY(page->buffer, page->bufsize);
+				}
+				page->alloc_pos = 0;
+				page->prev = nullptr;
+				page->next = nullptr;
+				return page;
+			}
+		}
+
+		void* ptr = std::malloc(sizeof(ArenaPage));
+		TR_ASSERT_MSG(ptr != nullptr, "couldn't create new arena page");
+		ArenaPage* page = new (ptr) ArenaPage(settings, size);
+		if (page->buffer == nullptr) {
+			std::free(page);
+			return nullptr;
+		}
+		return page;
+	}
+
+	// frees a page, giving it back to the page pool if possible
+	static void free_arena_page(const ArenaSettings& settings, ArenaPage* page)
+	{
+		isize cls = page_pool_usable(settings) && !page->reserved
+			? page_pool_class(page->bufsize)
+			: -1;
+		if (cls == -1) {
+			page->free();
+			std::free(page);
+			return;
+		}
+
+		// no one should touch it while it's in the pool
+		TR_ASAN_POISON_MEMORY(page->buffer, page->bufsize);
+		page->prev = nullptr;
+
+		if (page_magazine_dead) {
+			page->next = nullptr;
+			push_page_batch(cls, page, 1);
+			return;
+		}
+
+		page->next = page_magazine.pages[cls];
+		page_magazine.pages[cls] = page;
+		page_magazine.count[cls]++;
+
+		// too many, give half of them to everyone else
+		usize capacity = page_magazine_capacity(cls);
+		if (page_magazine.count[cls] > capacity) {
+			usize keep = capacity / 2;
+			ArenaPage* last_kept = page_magazine.pages[cls];
+			for (usize i = 1; i < keep; i++) {
+				last_kept = last_kept->next;
+			}
+
+			ArenaPage* batch = last_kept->next;
+			last_kept->next = nullptr;
+			push_page_batch(cls, batch, page_magazine.count[cls] - keep);
+			page_magazine.count[cls] = keep;
+		}
+	}
+} // namespace _tr
+
+} // namespace tr
+
+tr::_tr::PageMagazine::~PageMagazine()
+{
+	for (usize cls = 0; cls < PAGE_POOL_CLASSES; cls++) {
+		if (pages[cls] != nullptr) {
+			push_page_batch(cls, pages[cls], count[cls]);
+			pages[cls] = nullptr;
+			count[cls] = 0;
+		}
+	}
+	page_magazine_dead = true;
+}
@@ -23,55 +23,288 @@
  *
  */
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
 #include "trippin/common.h"
 #include "trippin/memory.h"
-#include "trippin/string.h"
 
 namespace tr {
 
 namespace _tr {
-	static thread_local byte scratch_buffer[SCRATCH_BACKING_BUFFER_SIZE];
-	static thread_local byte* scratch_alloc_pos = scratch_buffer;
+	// a stack is a chain of pages, the ones after the current page are always empty and just
+	// waiting to be used again
+	struct ScratchStack
+	{
+		ArenaPage* head = nullptr;
+		ArenaPage* current = nullptr;
+		usize capacity = 0;
+		// id of the newest scratch arena that hasn't been freed yet, 0 if there's none
+		uint64 top = 0;
+		uint64 next_id = 0;
+	};
+
+	struct ScratchStacks
+	{
+		ScratchStack stacks[SCRATCH_STACKS];
+
+		// thread_local destructors are the only way to find out a thread died, so this is
+		// one of the few places where RAII is the lesser evil
+		~ScratchStacks();
+	};
+
+	static thread_local ScratchStacks scratch_stacks;
+
+	static ArenaPage* new_scratch_page(usize size)
+	{
+		// zeroing is done on alloc since it's reused all the time anyway
+		void* ptr = std::malloc(sizeof(ArenaPage));
+		TR_ASSERT_MSG(ptr != nullptr, "couldn't create new scratch arena page");
+		return new (ptr) ArenaPage({.zero_initialize = false}, size);
+	}
+
+	// the newest scratch arena goes on top of the stack
+	static void push_scratch(ScratchStack& stack, uint64& id, uint64& prev_top)
+	{
+		id = ++stack.next_id;
+		prev_top = stack.top;
+		stack.top = id;
+	}
+
+	// if `page`/`pos` isn't before where the stack currently is then whatever was there has
+	// already been freed by a scratch arena made before this one
+	static bool scratch_is_before(const ScratchStack& stack, const ArenaPage* page, usize pos)
+	{
+		for (const ArenaPage* p = page; p != nullptr; p = p->next) {
+			if (p == stack.current) {
+				return p != page || pos <= p->alloc_pos;
+			}
+		}
+		return false;
+	}
 } // namespace _tr
 
 } // namespace tr
 
+tr::_tr::ScratchStacks::~ScratchStacks()
+{
+	for (ScratchStack& stack : stacks) {
+		ArenaPage* page = stack.head;
+		while (page != nullptr) {
+			ArenaPage* next = page->next;
+			page->free();
+			std::free(page);
+			page = next;
+		}
+		stack = {};
+	}
+}
+
 tr::ScratchArena::ScratchArena()
 {
-#ifdef TR_HAS_ADDRESS_SANITIZER
-	static bool hath_been_poisoned = false;
-	if (!hath_been_poisoned) {
-		TR_ASAN_POISON_MEMORY(_tr::scratch_buffer, SCRATCH_BACKING_BUFFER_SIZE);
-		hath_been_poisoned = true;
-	}
-#endif
-	_start_pos = _tr::scratch_alloc_pos;
+	_settings.name = "scratch";
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	_start_page = stack.current;
+	_start_pos = stack.current != nullptr ? stack.current->alloc_pos : 0;
+	_owner = &_tr::scratch_stacks;
+	_capacity = stack.capacity;
+	_tr::push_scratch(stack, _id, _prev_top);
+}
+
+tr::ScratchArena::ScratchArena(const tr::Arena& conflict)
+{
+	const auto* other = dynamic_cast<const ScratchArena*>(&conflict);
+	if (other != nullptr) {
+		_stack = static_cast<uint8>((other->_stack + 1) % SCRATCH_STACKS);
+	}
+
+	_settings.name = "scratch";
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	_start_page = stack.current;
+	_start_pos = stack.current != nullptr ? stack.current->alloc_pos : 0;
+	_owner = &_tr::scratch_stacks;
+	_capacity = stack.capacity;
+	_tr::push_scratch(stack, _id, _prev_top);
 }
 
 void tr::ScratchArena::free()
 {
-	// FIXME this doesn't handle destructors but i can't be bothered
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	if (stack.top == _id) {
+		stack.top = _prev_top;
+	}
+	_call_destructors();
+	_allocated = 0;
+	_rewind(_start_page, _start_pos);
+	_stats_unregister();
+}
+
+void tr::ScratchArena::reset()
+{
+	_call_destructors();
+	_allocated = 0;
+	_rewind(_start_page, _start_pos);
+	_stats_reset();
+}
+
+tr::ArenaCheckpoint tr::ScratchArena::checkpoint() const
+{
+	const _tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	return {
+		.page = stack.current,
+		.pos = stack.current != nullptr ? stack.current->alloc_pos : 0,
+		.destructors = _destructors,
+		.allocated = _allocated,
+	};
+}
+
+void tr::ScratchArena::rewind(ArenaCheckpoint checkpoint)
+{
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+
+	// it has to be somewhere between the start of this arena and where the stack is now
+	ArenaPage* start = _start_page != nullptr ? _start_page : stack.head;
+	usize start_pos = _start_page != nullptr ? _start_pos : 0;
+	bool valid = checkpoint.page == nullptr
+		? _start_page == nullptr
+		: _tr::scratch_is_before(stack, checkpoint.page, checkpoint.pos);
+	if (valid && checkpoint.page != nullptr) {
+		valid = false;
+		for (const ArenaPage* p = start; p != nullptr; p = p->next) {
+			if (p == checkpoint.page) {
+				valid = p != start || checkpoint.pos >= start_pos;
+				break;
+			}
+		}
+	}
+	if (!valid) [[unlikely]] {
+		tr::panic(
+			"can't rewind to a checkpoint from another arena, or one that was already "
+			"rewound/reset past"
+		);
+	}
+
+	_call_destructors_until(checkpoint.destructors);
+	_allocated = checkpoint.allocated;
+	_rewind(checkpoint.page, checkpoint.pos);
+	_stats_sync();
+}
+
+void tr::ScratchArena::_rewind(ArenaPage* to_page, usize to_pos)
+{
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	// nothing was ever allocated
+	if (stack.current == nullptr) {
+		return;
+	}
+
+	// null means the start of the stack
+	ArenaPage* start = to_page != nullptr ? to_page : stack.head;
+	usize start_pos = to_page != nullptr ? to_pos : 0;
+	if (!_tr::scratch_is_before(stack, start, start_pos)) {
+		return;
+	}
 
 	// rollback
-	TR_ASAN_UNPOISON_MEMORY(_start_pos, _allocated);
-	tr::strlib::explicit_memset(_start_pos, _allocated, 0);
-	TR_ASAN_POISON_MEMORY(_start_pos, _allocated);
+	for (ArenaPage* page = start;; page = page->next) {
+		usize from = page == start ? start_pos : 0;
+		TR_ASAN_POISON_MEMORY(
+			static_cast<byte*>(page->buffer) + from, page->alloc_pos - from
+		);
+		page->alloc_pos = from;
 
-	_fallback_arena.free();
-	_allocated = 0;
+		if (page == stack.current) {
+			break;
+		}
+	}
+	stack.current = start;
 }
 
 void* tr::ScratchArena::alloc(usize size, usize align)
 {
-	usize padding = tr::ArenaPage::align_ptr(_tr::scratch_alloc_pos, align);
-	usize available_space = static_cast<usize>(_tr::scratch_alloc_pos - _tr::scratch_buffer);
-	if (available_space < padding + size) {
-		// TODO this is extremely lazy, make the underlying buffer grow or some shit
-		return _fallback_arena.alloc(size, align);
+	_stats_register();
+
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	if (stack.current == nullptr) {
+		usize page_size = tr::max(SCRATCH_BACKING_BUFFER_SIZE, size + align);
+		stack.head = _tr::new_scratch_page(page_size);
+		stack.current = stack.head;
+		stack.capacity = stack.head->bufsize;
+		_stats_page();
+	}
+
+	usize pos = stack.current->alloc_pos;
+	void* ptr = stack.current->alloc(size, align);
+	if (ptr == nullptr) {
+		// the next page is empty so we can use that, unless it's too small
+		ArenaPage* next = stack.current->next;
+		if (next == nullptr || next->bufsize < size + align) {
+			usize page_size = tr::max(SCRATCH_BACKING_BUFFER_SIZE, size + align);
+			ArenaPage* page = _tr::new_scratch_page(page_size);
+			page->prev = stack.current;
+			page->next = next;
+			if (next != nullptr) {
+				next->prev = page;
+			}
+			stack.current->next = page;
+			stack.capacity += page->bufsize;
+			next = page;
+			_stats_page();
+		}
+
+		stack.current = next;
+		pos = 0;
+		ptr = stack.current->alloc(size, align);
+		TR_ASSERT(ptr != nullptr);
+		_stats_fallback();
 	}
 
-	_tr::scratch_alloc_pos += padding + size;
-	return _tr::scratch_alloc_pos;
+	std::memset(ptr, 0, size);
+	_allocated += size;
+	// the stack is thread local, this copy is for other threads
+	std::atomic_ref<usize>(_capacity).store(stack.capacity, std::memory_order_relaxed);
+	_stats_alloc(size, stack.current->alloc_pos - pos - size);
+	return ptr;
+}
+
+bool tr::ScratchArena::try_extend(void* ptr, usize old_size, usize new_size)
+{
+	_tr::ScratchStack& stack = _tr::scratch_stacks.stacks[_stack];
+	ArenaPage* page = stack.current;
+	if (page == nullptr || ptr == nullptr) {
+		return false;
+	}
+	if (new_size <= old_size) {
+		return true;
+	}
+
+	// if there's a newer scratch arena, it'd rewind over the extra space when it's freed
+	if (stack.top != _id) {
+		return false;
+	}
+
+	// it has to be the last thing in the page, and it also has to be ours
+	byte* base = static_cast<byte*>(page->buffer);
+	byte* end = static_cast<byte*>(ptr) + old_size;
+	if (end != base + page->alloc_pos) {
+		return false;
+	}
+	if (page == _start_page && static_cast<byte*>(ptr) < base + _start_pos) {
+		return false;
+	}
+
+	usize extra = new_size - old_size;
+	if (page->available_space() < extra) {
+		return false;
+	}
+
+	TR_ASAN_UNPOISON_MEMORY(end, extra);
+	std::memset(end, 0, extra);
+	page->alloc_pos += extra;
+	_allocated += extra;
+	_stats_alloc(extra, 0);
+	return true;
 }
 
 usize tr::ScratchArena::allocated() const
@@ -81,11 +314,16 @@ usize tr::ScratchArena::allocated() const
 
 usize tr::ScratchArena::capacity() const
 {
-	return SCRATCH_BACKING_BUFFER_SIZE + _fallback_arena.capacity();
+	// other scratch arenas on this thread could've grown the stack since the copy was made
+	usize capacity = 0;
+	if (_owner == &_tr::scratch_stacks) {
+		capacity = _tr::scratch_stacks.stacks[_stack].capacity;
+	}
+	else {
+		// const atomic_ref is a C++26 thing
+		std::atomic_ref<usize> copy{const_cast<usize&>(_capacity)};
+		capacity = copy.load(std::memory_order_relaxed);
+	}
+	return tr::max(capacity, SCRATCH_BACKING_BUFFER_SIZE);
 }
 
-void tr::ScratchArena::reset()
-{
-	this->free();
-	*this = tr::ScratchArena{};
-}
@@ -30,6 +30,7 @@
 #include "trippin/iofs.h"
 #include "trippin/memory.h"
 #include "trippin/string.h"
+#include "trippin/sync.h"
 #include "trippin/util.h"
 // man
 /* clang-format off */
@@ -38,7 +39,7 @@
 #include "trippin/bits/state.h"
 /* clang-format on */
 
-// TODO this has to be thread-safe somehow
+// TODO the rest of this has to be thread-safe somehow (the arenas already are, see ConcurrentArena)
 // you could use a thread_local variable but freeing becomes fucky and some state has to be shared
 // so i'm just using an std::atomic<std::shared_ptr<T>> here, along with some helper functions so
 // that it gets freed properly
@@ -54,26 +55,22 @@ void free_arena(tr::Arena* arena)
 
 tr::Arena& tr::_tr::core_arena()
 {
-	static bool initialized = false;
-	// THE HORROR HAS BECOME TOO GREAT FOR ANY ONE MIND TO BARE
-	static std::atomic<std::shared_ptr<Arena>> core_arena;
-	if (!initialized) {
-		core_arena = std::shared_ptr<Arena>{new Arena(), free_arena};
-		initialized = true;
-	}
-	return *static_cast<std::shared_ptr<Arena>>(core_arena);
+	// function statics are initialized exactly once even with many threads, and
+	// ConcurrentArena takes care of the rest
+	static std::shared_ptr<ConcurrentArena> core_arena{
+		new ConcurrentArena({.name = "core"}), free_arena
+	};
+	return *core_arena;
 }
 
 tr::Arena& tr::_tr::consty_arena()
 {
-	static bool initialized = false;
-	// THE HORROR HAS BECOME TOO GREAT FOR ANY ONE MIND TO BARE
-	static std::atomic<std::shared_ptr<Arena>> consty_arena;
-	if (!initialized) {
-		consty_arena = std::shared_ptr<Arena>{new Arena(), free_arena};
-		initialized = true;
-	}
-	return *static_cast<std::shared_ptr<Arena>>(consty_arena);
+	// function statics are initialized exactly once even with many threads, and
+	// ConcurrentArena takes care of the rest
+	static std::shared_ptr<ConcurrentArena> consty_arena{
+		new ConcurrentArena({.name = "consty"}), free_arena
+	};
+	return *consty_arena;
 }
 
 tr::Array<tr::File>& tr::_tr::logfiles()
@@ -112,20 +109,13 @@ tr::WrapArena& tr::_tr::tmp_strings()
 	return *static_cast<std::shared_ptr<WrapArena>>(arena);
 }
 
-tr::HashMap<tr::ErrorType, tr::String (*)(tr::ErrorArgs args)>& tr::_tr::error_table()
+tr::ConcurrentHashMap<tr::ErrorType, tr::String (*)(tr::ErrorArgs args)>&
+tr::_tr::error_table()
 {
-	static bool initialized = false;
-	// THE HORROR HAS BECOME TOO GREAT FOR ANY ONE MIND TO BARE
-	static std::atomic<std::shared_ptr<HashMap<ErrorType, String (*)(ErrorArgs args)>>>
-		error_table;
-	if (!initialized) {
-		// AND YOU MAY FIND YOURSELF
-		error_table = std::shared_ptr<HashMap<ErrorType, String (*)(ErrorArgs)>>{
-			new HashMap<ErrorType, String (*)(ErrorArgs args)>(tr::_tr::core_arena())
-		};
-		initialized = true;
-	}
-	return *static_cast<std::shared_ptr<HashMap<ErrorType, String (*)(ErrorArgs args)>>>(
-		error_table
-	);
+	// function statics are initialized exactly once even with many threads, and
+	// ConcurrentHashMap takes care of the rest
+	static ConcurrentHashMap<ErrorType, String (*)(ErrorArgs args)> error_table{
+		tr::_tr::core_arena()
+	};
+	return error_table;
 }
@@ -28,7 +28,7 @@
 
 namespace tr {
 
-// TODO there's no way this is thread safe
+// TODO there's no way this is thread safe (except the arenas, those are ConcurrentArenas)
 
 namespace _tr {
 	// functions instead of global variables so that we can control when they're initialized,
@@ -41,6 +41,7 @@ namespace _tr {
 
 // unfortunately some headers need this so we have to use this bullshit
 #ifdef _TRIPPIN_MEMORY_H
+	// safe to allocate from any thread
 	Arena& core_arena();
 
 	// std::initializer_list<T> doesn't live very long. to prevent fucking (dangling ptrs), we
@@ -58,8 +59,8 @@ namespace _tr {
 #if defined(_TRIPPIN_UTIL_H) && defined(_TR_BULLSHIT_SO_THAT_IT_WORKS)
 	Signal<bool>& on_quit();
 
-	#ifdef _TRIPPIN_ERROR_H
-	HashMap<ErrorType, String (*)(ErrorArgs args)>& error_table();
+	#if defined(_TRIPPIN_ERROR_H) && defined(_TRIPPIN_SYNC_H)
+	ConcurrentHashMap<ErrorType, String (*)(ErrorArgs args)>& error_table();
 	#endif
 #endif
 
@@ -32,6 +32,7 @@
 #endif
 #include "trippin/memory.h"
 #include "trippin/string.h"
+#include "trippin/sync.h"
 #include "trippin/util.h"
 /* clang-format off */
 // man
@@ -47,23 +48,18 @@ tr::TempString tr::Error::message() const
 
 bool tr::register_error_type(ErrorType id, TempString (*msg_func)(ErrorArgs args), bool override)
 {
-	// quite the mouthful
-	Maybe<TempString (*&)(ErrorArgs)> perchance = _tr::error_table().try_get(id);
-	if (perchance.is_valid()) {
-		if (override) {
-			perchance.unwrap() = msg_func;
-		}
-		return false;
+	// other threads could be registering at the same time, so this has to be a single
+	// operation, not a check and then an insert
+	if (override) {
+		return _tr::error_table().set(id, msg_func);
 	}
-
-	_tr::error_table()[id] = msg_func;
-	return true;
+	return _tr::error_table().insert(id, msg_func);
 }
 
 tr::TempString tr::error_message(tr::ErrorType id, tr::ErrorArgs args)
 {
 	// quite the mouthful
-	Maybe<TempString (*&)(ErrorArgs)> perchance = _tr::error_table().try_get(id);
+	Maybe<TempString (*)(ErrorArgs)> perchance = _tr::error_table().get(id);
 	if (perchance.is_invalid()) {
 		tr::panic("error type %lu doesn't exist", static_cast<uint64>(id));
 	}
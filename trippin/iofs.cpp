@@ -76,7 +76,7 @@ tr::Result<tr::String> tr::Reader::read_string(tr::Arena& arena, int64 length)
 
 tr::Result<tr::String> tr::Reader::read_line(Arena& arena)
 {
-	ScratchArena scratch{};
+	ScratchArena scratch{arena};
 	TR_DEFER(scratch.free());
 	Array<char> linema{scratch, 0};
 
@@ -247,7 +247,7 @@ static tr::String from_win32_to_trippin_str(tr::Arena& arena, WinStrConst str)
 
 tr::Result<tr::File> tr::File::open(tr::Arena& arena, tr::String path, FileMode mode)
 {
-	ScratchArena scratch{};
+	ScratchArena scratch{arena};
 	TR_DEFER(scratch.free());
 	path = tr::path(scratch, path);
 	tr::_reset_os_errors();
@@ -560,7 +560,7 @@ tr::Result<void> tr::remove_dir(tr::String path)
 tr::Result<tr::Array<tr::String>>
 tr::list_dir(tr::Arena& arena, tr::String path, bool include_hidden)
 {
-	ScratchArena scratch{};
+	ScratchArena scratch{arena};
 	TR_DEFER(scratch.free());
 	path = tr::path(scratch, path);
 	// this looks so horrible what the fuck is wrong with you bill gates
@@ -661,7 +661,7 @@ void tr::_init_paths()
 
 tr::Result<tr::File> tr::File::open(tr::Arena& arena, tr::String path, tr::FileMode mode)
 {
-	ScratchArena scratch{};
+	ScratchArena scratch{arena};
 	TR_DEFER(scratch.free());
 	path = tr::path(scratch, path);
 	tr::_reset_os_errors();
@@ -993,7 +993,7 @@ tr::Result<tr::Array<tr::String>>
 tr::list_dir(tr::Arena& arena, tr::String path, bool include_hidden)
 {
 	// FIXME this might be broken for some fucking reason
-	ScratchArena scratch{};
+	ScratchArena scratch{arena};
 	TR_DEFER(scratch.free());
 	path = tr::path(scratch, path);
 	tr::_reset_os_errors();
@@ -26,8 +26,21 @@
 #include "trippin/memory.h"
 
 #include <cstdlib>
+#include <cstring>
 
-#include "trippin/bits/scratch.cpp" // yea
+#ifdef TR_OS_WINDOWS
+	#include "trippin/antiwindows.h"
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+#ifdef TR_ARENA_STATS
+	#include <mutex>
+#endif
+
+#include "trippin/bits/pagepool.cpp" // yea
+#include "trippin/bits/scratch.cpp"
 #include "trippin/common.h"
 #include "trippin/log.h"
 #include "trippin/math.h"
@@ -37,6 +50,94 @@ namespace tr {
 
 thread_local Arena _the_real_scratchpad({.page_size = tr::kb_to_bytes(4)});
 
+#ifdef TR_ARENA_STATS
+// every arena that has allocated something and hasn't been freed yet
+static std::mutex _arena_registry_mutex;
+static Arena** _arena_registry = nullptr;
+static usize _arena_registry_len = 0;
+static usize _arena_registry_cap = 0;
+#endif
+
+// virtual memory faffery for reserved arenas
+
+static usize _os_page_size()
+{
+#ifdef TR_OS_WINDOWS
+	SYSTEM_INFO info{};
+	GetSystemInfo(&info);
+	return static_cast<usize>(info.dwPageSize);
+#else
+	return static_cast<usize>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+static void* _reserve_memory(usize size)
+{
+#ifdef TR_OS_WINDOWS
+	return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	// MAP_NORESERVE so that linux doesn't count the whole thing against overcommit limits
+	void* ptr = mmap(
+		nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0
+	);
+	return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+}
+
+static bool _commit_memory(void* ptr, usize size)
+{
+#ifdef TR_OS_WINDOWS
+	return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+	return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void _decommit_memory(void* ptr, usize size)
+{
+#ifdef TR_OS_WINDOWS
+	VirtualFree(ptr, size, MEM_DECOMMIT);
+#else
+	// MADV_DONTNEED is what actually gives the memory back, it also comes back zeroed
+	madvise(ptr, size, MADV_DONTNEED);
+	mprotect(ptr, size, PROT_NONE);
+#endif
+}
+
+// picks the size for the next page according to the growth policy, without caring about whether
+// the allocation fits
+static usize _grow_page_size(const ArenaSettings& settings, usize pages, usize last_page_size)
+{
+	switch (settings.growth_policy) {
+	case ArenaSettings::GrowthPolicy::FIXED:
+		return settings.page_size;
+	case ArenaSettings::GrowthPolicy::DOUBLE:
+		if (last_page_size == 0) {
+			return settings.page_size;
+		}
+		return tr::max(
+			settings.page_size, tr::min(last_page_size * 2, settings.max_page_size)
+		);
+	case ArenaSettings::GrowthPolicy::CALLBACK:
+		TR_ASSERT_MSG(
+			settings.grow_func != nullptr,
+			"arena growth policy is CALLBACK but there's no grow_func"
+		);
+		return settings.grow_func(pages, last_page_size);
+	}
+	return settings.page_size;
+}
+
+static void _release_memory(void* ptr, usize size)
+{
+#ifdef TR_OS_WINDOWS
+	(void)size;
+	VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+	munmap(ptr, size);
+#endif
+}
+
 }
 
 tr::ArenaPage::ArenaPage(tr::ArenaSettings settings, usize size)
@@ -44,7 +145,16 @@ tr::ArenaPage::ArenaPage(tr::ArenaSettings settings, usize size)
 {
 	TR_ASSERT(size != 0);
 
-	if (settings.zero_initialize) {
+	if (settings.reserve_size.is_valid()) {
+		// page aligned so that committing doesn't touch memory outside the page
+		usize os_page = tr::_os_page_size();
+		this->reserved = true;
+		this->commit_step = tr::max(settings.page_size, os_page);
+		this->commit_step = (this->commit_step + os_page - 1) & ~(os_page - 1);
+		this->committed = 0;
+		this->buffer = tr::_reserve_memory(size);
+	}
+	else if (settings.zero_initialize) {
 		this->buffer = std::calloc(1, size);
 	}
 	else {
@@ -64,15 +174,57 @@ tr::ArenaPage::ArenaPage(tr::ArenaSettings settings, usize size)
 	}
 
 	// should be inaccessible before any .alloc() call
-	TR_ASAN_POISON_MEMORY(this->buffer, size);
+	// reserved pages get poisoned as they're committed, poisoning a few gigabytes of nothing
+	// would be slow
+	if (!this->reserved) {
+		TR_ASAN_POISON_MEMORY(this->buffer, size);
+	}
 }
 
 void tr::ArenaPage::free()
 {
-	if (this->buffer != nullptr) {
+	if (this->buffer == nullptr) {
+		return;
+	}
+
+	if (this->reserved) {
+		tr::_release_memory(buffer, bufsize);
+	}
+	else {
 		std::free(buffer);
-		this->buffer = nullptr;
 	}
+	this->buffer = nullptr;
+}
+
+bool tr::ArenaPage::commit(usize end)
+{
+	if (end <= this->committed) {
+		return true;
+	}
+
+	usize new_committed = (end + commit_step - 1) / commit_step * commit_step;
+	new_committed = tr::min(new_committed, bufsize);
+
+	byte* base = static_cast<byte*>(buffer);
+	if (!tr::_commit_memory(base + committed, new_committed - committed)) {
+		return false;
+	}
+	TR_ASAN_POISON_MEMORY(base + committed, new_committed - committed);
+	this->committed = new_committed;
+	return true;
+}
+
+void tr::ArenaPage::decommit(usize keep)
+{
+	keep = (keep + commit_step - 1) / commit_step * commit_step;
+	if (keep >= this->committed) {
+		return;
+	}
+
+	byte* base = static_cast<byte*>(buffer);
+	TR_ASAN_UNPOISON_MEMORY(base + keep, committed - keep);
+	tr::_decommit_memory(base + keep, committed - keep);
+	this->committed = keep;
 }
 
 usize tr::ArenaPage::available_space() const
@@ -97,6 +249,9 @@ void* tr::ArenaPage::alloc(usize size, usize align)
 	if (available_space() < padding + size) {
 		return nullptr;
 	}
+	if (reserved && !commit(alloc_pos + padding + size)) {
+		return nullptr;
+	}
 
 	// ma
 	alloc_pos += padding;
@@ -140,21 +295,82 @@ void tr::Arena::free()
 
 	while (head != nullptr) {
 		ArenaPage* next = head->next;
-		head->free();
-		std::free(head);
+		tr::_tr::free_arena_page(_settings, head);
 		head = next;
 	}
+
+	_stats_unregister();
+
+	// so it can be used again without exploding
+	_page = nullptr;
+	_pages = 0;
+	_capacity = 0;
+	_allocated = 0;
+	_last_page_size = 0;
+}
+
+bool tr::Arena::_reuse_page(usize size, usize align)
+{
+	ArenaPage* page = _page->next;
+	while (page != nullptr && page->bufsize < size + align) {
+		page = page->next;
+	}
+	if (page == nullptr) {
+		return false;
+	}
+
+	// the smaller pages we skipped stay after this one so they can still be used later
+	if (page != _page->next) {
+		page->prev->next = page->next;
+		if (page->next != nullptr) {
+			page->next->prev = page->prev;
+		}
+
+		page->prev = _page;
+		page->next = _page->next;
+		_page->next->prev = page;
+		_page->next = page;
+	}
+
+	_page = page;
+	return true;
 }
 
 void* tr::Arena::alloc(usize size, usize align)
 {
 	// does it fit in the current page?
 	if (_page != nullptr) {
+		usize pos = _page->alloc_pos;
 		void* ptr = _page->alloc(size, align);
 		if (ptr != nullptr) {
 			_allocated += size;
+			_stats_alloc(size, _page->alloc_pos - pos - size);
 			return ptr;
 		}
+
+		// maybe a page from before the last reset fits
+		if (_reuse_page(size, align)) {
+			ptr = _page->alloc(size, align);
+			TR_ASSERT(ptr != nullptr);
+			_allocated += size;
+			_stats_alloc(size, _page->alloc_pos - size);
+			_stats_fallback();
+			return ptr;
+		}
+	}
+
+	// reserved arenas only ever have the one page
+	if (_settings.reserve_size.is_valid() && _page != nullptr) {
+		if (_settings.error_behavior == ArenaSettings::ErrorBehavior::PANIC) {
+			tr::panic(
+				"reserved arena out of space! (%zu B reserved, tried to "
+				"allocate %zu B)",
+				_page->bufsize, size
+			);
+		}
+		else {
+			return nullptr;
+		}
 	}
 
 	// can we make a new page?
@@ -175,18 +391,31 @@ void* tr::Arena::alloc(usize size, usize align)
 	}
 
 	// it doesn't fit, make a new page
-	usize new_page_size = tr::max(_settings.page_size, size + align);
-	void* new_page_ptr = std::malloc(sizeof(ArenaPage));
-	TR_ASSERT_MSG(new_page_ptr != nullptr, "couldn't create new arena page");
-	ArenaPage* new_page = new (new_page_ptr) ArenaPage(_settings, new_page_size);
+	usize grown_size = tr::_grow_page_size(_settings, _pages, _last_page_size);
+	usize new_page_size = tr::max(grown_size, size + align);
+	new_page_size = tr::_tr::page_pool_size(_settings, new_page_size);
+	if (_settings.reserve_size.is_valid()) {
+		new_page_size = _settings.reserve_size.unwrap();
+	}
+	ArenaPage* new_page = tr::_tr::new_arena_page(_settings, new_page_size);
+	if (new_page == nullptr) {
+		return nullptr;
+	}
 
+	// the new page goes right after the current one, so the leftovers from a reset stay after
+	// it
 	new_page->prev = _page;
 	if (_page != nullptr) {
+		new_page->next = _page->next;
+		if (_page->next != nullptr) {
+			_page->next->prev = new_page;
+		}
 		_page->next = new_page;
 	}
 	_page = new_page;
 	_capacity += new_page_size;
 	_pages++;
+	_last_page_size = grown_size;
 
 	// actually allocate frfrfrfr no cap ong icl
 	void* ptr = _page->alloc(size, align);
@@ -202,13 +431,54 @@ void* tr::Arena::alloc(usize size, usize align)
 		}
 	};
 	_allocated += size;
+	_stats_alloc(size, _page->alloc_pos - size);
+	_stats_page();
+	if (_page->prev != nullptr) {
+		_stats_fallback();
+	}
 	return ptr;
 }
 
+bool tr::Arena::try_extend(void* ptr, usize old_size, usize new_size)
+{
+	if (_page == nullptr || ptr == nullptr) {
+		return false;
+	}
+	if (new_size <= old_size) {
+		return true;
+	}
+
+	// is it the last thing in the page?
+	byte* end = static_cast<byte*>(ptr) + old_size;
+	if (end != static_cast<byte*>(_page->buffer) + _page->alloc_pos) {
+		return false;
+	}
+
+	usize extra = new_size - old_size;
+	if (_page->available_space() < extra) {
+		return false;
+	}
+	if (_page->reserved && !_page->commit(_page->alloc_pos + extra)) {
+		return false;
+	}
+
+	// the rest of the page is already zeroed (if it should be)
+	TR_ASAN_UNPOISON_MEMORY(end, extra);
+	_page->alloc_pos += extra;
+	_allocated += extra;
+	_stats_alloc(extra, 0);
+	return true;
+}
+
 void tr::Arena::_call_destructors()
+{
+	_call_destructors_until(nullptr);
+}
+
+void tr::Arena::_call_destructors_until(DestructorCall* stop)
 {
 	// yea
-	while (_destructors != nullptr) {
+	while (_destructors != nullptr && _destructors != stop) {
 		// idfk why it does that
 		if (_destructors->object == nullptr) {
 			break;
@@ -219,6 +489,79 @@ void tr::Arena::_call_destructors()
 	}
 }
 
+void tr::Arena::_push_destructor(DestructorCall* call)
+{
+	call->next = _destructors;
+	_destructors = call;
+}
+
+tr::ArenaCheckpoint tr::Arena::checkpoint() const
+{
+	return {
+		.page = _page,
+		.pos = _page != nullptr ? _page->alloc_pos : 0,
+		.destructors = _destructors,
+		.allocated = _allocated,
+	};
+}
+
+void tr::Arena::rewind(ArenaCheckpoint checkpoint)
+{
+	// it doesn't make a page until you allocate something
+	if (_page == nullptr) {
+		TR_ASSERT_MSG(
+			checkpoint.page == nullptr, "can't rewind to a checkpoint from another arena"
+		);
+		return;
+	}
+
+	ArenaPage* head = _page;
+	while (head->prev != nullptr) {
+		head = head->prev;
+	}
+
+	// a checkpoint from before anything was allocated goes back to the start
+	ArenaPage* target = checkpoint.page != nullptr ? checkpoint.page : head;
+	usize pos = checkpoint.page != nullptr ? checkpoint.pos : 0;
+
+	// the checkpoint has to be somewhere before where we are now
+	ArenaPage* page = _page;
+	while (page != nullptr && page != target) {
+		page = page->prev;
+	}
+	if (page == nullptr || (target == _page && pos > _page->alloc_pos)) [[unlikely]] {
+		tr::panic(
+			"can't rewind to a checkpoint from another arena, or one that was already "
+			"rewound/reset past"
+		);
+	}
+
+	_call_destructors_until(checkpoint.destructors);
+
+	// the pages after the target stay after it, so they get reused like the leftovers from a
+	// reset
+	for (page = target;; page = page->next) {
+		usize from = page == target ? pos : 0;
+		if (page->alloc_pos > from) {
+			byte* start = static_cast<byte*>(page->buffer) + from;
+			if (_settings.zero_initialize) {
+				TR_ASAN_UNPOISON_MEMORY(start, page->alloc_pos - from);
+				std::memset(start, 0, page->alloc_pos - from);
+			}
+			TR_ASAN_POISON_MEMORY(start, page->alloc_pos - from);
+		}
+		page->alloc_pos = from;
+
+		if (page == _page) {
+			break;
+		}
+	}
+
+	_page = target;
+	_allocated = checkpoint.allocated;
+	_stats_sync();
+}
+
 void tr::Arena::reset()
 {
 	// it doesn't make a page until you allocate something
@@ -233,28 +576,180 @@ void tr::Arena::reset()
 		head = head->prev;
 	}
 
-	// TODO we should reuse all the other pages
-	// i just can't be bothered to fix Arena::alloc() to support that
-	ArenaPage* headfrfr = head;
-	while (head != nullptr && head != headfrfr) {
-		_capacity -= head->bufsize;
-		ArenaPage* next = head->next;
-		head->free();
-		std::free(head);
-		head = next;
+	// only the pages up to the current one have been used, the rest are still empty. a plain
+	// memset is fine here, we're about to hand this memory out again so it can't be optimized
+	// away
+	ArenaPage* used_end = _page->next;
+	for (ArenaPage* page = head; page != used_end; page = page->next) {
+		// decommitted memory comes back zeroed so we only have to clear what's left
+		if (page->reserved) {
+			page->decommit(_settings.decommit_watermark);
+			page->alloc_pos = tr::min(page->alloc_pos, page->committed);
+		}
+
+		if (_settings.zero_initialize && page->alloc_pos > 0) {
+			TR_ASAN_UNPOISON_MEMORY(page->buffer, page->alloc_pos);
+			std::memset(page->buffer, 0, page->alloc_pos);
+		}
+		TR_ASAN_POISON_MEMORY(
+			page->buffer, page->reserved ? page->committed : page->bufsize
+		);
+		page->alloc_pos = 0;
 	}
 
-	// we keep the first page :)
-	_page = headfrfr;
-	if (_settings.zero_initialize) {
-		TR_ASAN_UNPOISON_MEMORY(headfrfr->buffer, headfrfr->bufsize);
-		tr::strlib::explicit_memset(headfrfr->buffer, headfrfr->bufsize, 0);
-		TR_ASAN_POISON_MEMORY(headfrfr->buffer, headfrfr->bufsize);
+	// we always keep the first page, and as many of the others as the settings let us
+	usize retained = head->bufsize;
+	ArenaPage* page = head->next;
+	while (page != nullptr) {
+		ArenaPage* next = page->next;
+
+		bool keep = true;
+		if (_settings.max_retained_bytes.is_valid()) {
+			keep = retained + page->bufsize <= _settings.max_retained_bytes.unwrap();
+		}
+
+		if (keep) {
+			retained += page->bufsize;
+		}
+		else {
+			page->prev->next = next;
+			if (next != nullptr) {
+				next->prev = page->prev;
+			}
+			_capacity -= page->bufsize;
+			_pages--;
+			tr::_tr::free_arena_page(_settings, page);
+		}
+		page = next;
 	}
-	headfrfr->alloc_pos = 0;
-	headfrfr->prev = nullptr;
-	headfrfr->next = nullptr;
+
+	_page = head;
 	_allocated = 0;
+	_stats_reset();
+}
+
+tr::Arena::~Arena()
+{
+	// an arena that goes out of scope without being freed shouldn't stay in the registry
+	_stats_unregister();
+}
+
+const char* tr::Arena::name() const
+{
+	return _settings.name;
+}
+
+tr::ArenaStats tr::Arena::stats() const
+{
+#ifdef TR_ARENA_STATS
+	// const atomic_ref is a C++26 thing
+	auto load = [](const usize& x) -> usize {
+		std::atomic_ref<usize> ref{const_cast<usize&>(x)};
+		return ref.load(std::memory_order_relaxed);
+	};
+	return {
+		.requested = load(_stats.requested),
+		.padding = load(_stats.padding),
+		.pages_made = load(_stats.pages_made),
+		.peak = load(_stats.peak),
+		.resets = load(_stats.resets),
+		.fallbacks = load(_stats.fallbacks),
+	};
+#else
+	return {};
+#endif
+}
+
+void tr::Arena::_stats_alloc(usize size, usize padding)
+{
+#ifdef TR_ARENA_STATS
+	std::atomic_ref<usize>(_stats.requested).fetch_add(size, std::memory_order_relaxed);
+	std::atomic_ref<usize>(_stats.padding).fetch_add(padding, std::memory_order_relaxed);
+
+	usize now = this->allocated();
+	std::atomic_ref<usize> peak{_stats.peak};
+	usize old_peak = peak.load(std::memory_order_relaxed);
+	while (old_peak < now &&
+	       !peak.compare_exchange_weak(old_peak, now, std::memory_order_relaxed)) {
+	}
+	_stats_sync();
+#else
+	(void)size;
+	(void)padding;
+#endif
+}
+
+void tr::Arena::_stats_page()
+{
+#ifdef TR_ARENA_STATS
+	_stats_register();
+	std::atomic_ref<usize>(_stats.pages_made).fetch_add(1, std::memory_order_relaxed);
+	_stats_sync();
+#endif
+}
+
+void tr::Arena::_stats_fallback()
+{
+#ifdef TR_ARENA_STATS
+	std::atomic_ref<usize>(_stats.fallbacks).fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+void tr::Arena::_stats_reset()
+{
+#ifdef TR_ARENA_STATS
+	std::atomic_ref<usize>(_stats.resets).fetch_add(1, std::memory_order_relaxed);
+	_stats_sync();
+#endif
+}
+
+void tr::Arena::_stats_sync()
+{
+#ifdef TR_ARENA_STATS
+	// only called by whoever is using the arena, so reading the regular counters is fine
+	std::atomic_ref<usize>(_seen_allocated).store(this->allocated(), std::memory_order_relaxed);
+	std::atomic_ref<usize>(_seen_capacity).store(this->capacity(), std::memory_order_relaxed);
+	std::atomic_ref<usize>(_seen_pages).store(this->pages(), std::memory_order_relaxed);
+#endif
+}
+
+void tr::Arena::_stats_register()
+{
+#ifdef TR_ARENA_STATS
+	std::atomic_ref<bool> registered{_registered};
+	if (registered.load(std::memory_order_relaxed) ||
+	    registered.exchange(true, std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{_arena_registry_mutex};
+	if (_arena_registry_len == _arena_registry_cap) {
+		_arena_registry_cap = tr::max(_arena_registry_cap * 2, usize{16});
+		void* new_registry =
+			std::realloc(_arena_registry, _arena_registry_cap * sizeof(Arena*));
+		TR_ASSERT_MSG(new_registry != nullptr, "couldn't grow the arena registry");
+		_arena_registry = static_cast<Arena**>(new_registry);
+	}
+	_arena_registry[_arena_registry_len++] = this;
+#endif
+}
+
+void tr::Arena::_stats_unregister()
+{
+#ifdef TR_ARENA_STATS
+	std::atomic_ref<bool> registered{_registered};
+	if (!registered.exchange(false, std::memory_order_relaxed)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{_arena_registry_mutex};
+	for (usize i = 0; i < _arena_registry_len; i++) {
+		if (_arena_registry[i] == this) {
+			_arena_registry[i] = _arena_registry[--_arena_registry_len];
+			break;
+		}
+	}
+#endif
 }
 
 usize tr::Arena::allocated() const
@@ -267,6 +762,350 @@ usize tr::Arena::capacity() const
 	return this->_capacity;
 }
 
+usize tr::Arena::pages() const
+{
+	return this->_pages;
+}
+
+tr::ConcurrentArena::ConcurrentArena(ArenaSettings settings)
+	: Arena(settings)
+{
+	// committing memory would have to be atomic too, which is more trouble than it's worth
+	TR_ASSERT_MSG(
+		!settings.reserve_size.is_valid(), "ConcurrentArena doesn't support reserved arenas"
+	);
+}
+
+tr::ArenaPage* tr::ConcurrentArena::_new_page(usize size)
+{
+	// this can go a bit over the limit if several threads run out at the same time, it's fine
+	if (_settings.max_pages.is_valid()) {
+		usize max_pages = _settings.max_pages.unwrap();
+		if (_atomic_pages.load(std::memory_order_relaxed) >= max_pages) {
+			if (_settings.error_behavior == ArenaSettings::ErrorBehavior::PANIC) {
+				tr::panic(
+					"arena out of pages! (%zu pages * %zu size = %zu "
+					"available)",
+					max_pages, _settings.page_size,
+					max_pages * _settings.page_size
+				);
+			}
+			else {
+				return nullptr;
+			}
+		}
+	}
+
+	size = tr::_tr::page_pool_size(_settings, size);
+	ArenaPage* page = tr::_tr::new_arena_page(_settings, size);
+	if (page == nullptr) {
+		return nullptr;
+	}
+
+	// asan poisons memory by writing to shadow bytes, which is a data race when two threads
+	// allocate right next to each other, so concurrent pages just don't get poisoned
+	TR_ASAN_UNPOISON_MEMORY(page->buffer, size);
+	return page;
+}
+
+void* tr::ConcurrentArena::alloc(usize size, usize align)
+{
+	// only used to size new pages, the bump in the current page is exact so the last
+	// allocation can still be extended in place
+	usize reserved = size + align - 1;
+
+	// big allocations get their own page so they don't make us throw away the current page
+	ArenaPage* page = _current.load(std::memory_order_acquire);
+	usize big_size = page != nullptr ? tr::max(_settings.page_size, page->bufsize)
+					 : _settings.page_size;
+	if (reserved > big_size) {
+		ArenaPage* big_page = _new_page(reserved);
+		if (big_page == nullptr) {
+			return nullptr;
+		}
+		void* ptr = big_page->alloc(size, align);
+		TR_ASSERT(ptr != nullptr);
+
+		big_page->next = _big_pages.load(std::memory_order_relaxed);
+		while (!_big_pages.compare_exchange_weak(
+			big_page->next, big_page, std::memory_order_release,
+			std::memory_order_relaxed
+		)) {
+		}
+
+		_atomic_capacity.fetch_add(big_page->bufsize, std::memory_order_relaxed);
+		_atomic_pages.fetch_add(1, std::memory_order_relaxed);
+		_atomic_allocated.fetch_add(size, std::memory_order_relaxed);
+		_stats_alloc(size, big_page->alloc_pos - size);
+		_stats_page();
+		return ptr;
+	}
+
+	while (true) {
+		// does it fit in the current page?
+		if (page != nullptr) {
+			byte* base = static_cast<byte*>(page->buffer);
+			std::atomic_ref<usize> alloc_pos{page->alloc_pos};
+			usize pos = alloc_pos.load(std::memory_order_relaxed);
+			// the padding depends on where it lands, so if someone else got there first
+			// it has to be worked out again
+			while (pos <= page->bufsize) {
+				usize padding = ArenaPage::align_ptr(base + pos, align);
+				usize end = pos + padding + size;
+				if (end > page->bufsize) {
+					break;
+				}
+				if (alloc_pos.compare_exchange_weak(
+					    pos, end, std::memory_order_relaxed
+				    )) {
+					_atomic_allocated.fetch_add(
+						size, std::memory_order_relaxed
+					);
+					_stats_alloc(size, padding);
+					return base + pos + padding;
+				}
+			}
+		}
+
+		// it doesn't fit, make a new page and allocate in it before anyone else can see it
+		usize new_page_size = tr::_grow_page_size(
+			_settings, _atomic_pages.load(std::memory_order_relaxed),
+			page != nullptr ? page->bufsize : 0
+		);
+		ArenaPage* new_page = _new_page(tr::max(new_page_size, reserved));
+		if (new_page == nullptr) {
+			return nullptr;
+		}
+		void* ptr = new_page->alloc(size, align);
+		TR_ASSERT(ptr != nullptr);
+		new_page->prev = page;
+		// other threads can start allocating here as soon as it's swapped in
+		usize padding = new_page->alloc_pos - size;
+
+		if (_current.compare_exchange_strong(
+			    page, new_page, std::memory_order_acq_rel, std::memory_order_acquire
+		    )) {
+			_atomic_capacity.fetch_add(new_page->bufsize, std::memory_order_relaxed);
+			_atomic_pages.fetch_add(1, std::memory_order_relaxed);
+			_atomic_allocated.fetch_add(size, std::memory_order_relaxed);
+			_stats_alloc(size, padding);
+			_stats_page();
+			if (page != nullptr) {
+				_stats_fallback();
+			}
+			return ptr;
+		}
+
+		// another thread swapped in a page first, `page` is now that page so try again with
+		// it
+		tr::_tr::free_arena_page(_settings, new_page);
+	}
+}
+
+bool tr::ConcurrentArena::try_extend(void* ptr, usize old_size, usize new_size)
+{
+	ArenaPage* page = _current.load(std::memory_order_acquire);
+	if (page == nullptr || ptr == nullptr) {
+		return false;
+	}
+	if (new_size <= old_size) {
+		return true;
+	}
+
+	// it has to end exactly where the page's bump pointer is, if anything else got allocated
+	// after it the CAS fails
+	byte* base = static_cast<byte*>(page->buffer);
+	byte* end = static_cast<byte*>(ptr) + old_size;
+	if (end < base || end > base + page->bufsize) {
+		return false;
+	}
+
+	usize expected = static_cast<usize>(end - base);
+	usize extra = new_size - old_size;
+	if (expected + extra > page->bufsize) {
+		return false;
+	}
+	std::atomic_ref<usize> alloc_pos{page->alloc_pos};
+	if (!alloc_pos.compare_exchange_strong(
+		    expected, expected + extra, std::memory_order_relaxed
+	    )) {
+		return false;
+	}
+
+	_atomic_allocated.fetch_add(extra, std::memory_order_relaxed);
+	_stats_alloc(extra, 0);
+	return true;
+}
+
+tr::ArenaCheckpoint tr::ConcurrentArena::checkpoint() const
+{
+	ArenaPage* page = _current.load(std::memory_order_acquire);
+	usize pos = 0;
+	if (page != nullptr) {
+		pos = std::atomic_ref<usize>(page->alloc_pos).load(std::memory_order_relaxed);
+	}
+
+	std::atomic_ref<DestructorCall*> destructors{const_cast<DestructorCall*&>(_destructors)};
+	return {
+		.page = page,
+		.pos = pos,
+		.destructors = destructors.load(std::memory_order_acquire),
+		.allocated = _atomic_allocated.load(std::memory_order_relaxed),
+		.big_pages = _big_pages.load(std::memory_order_acquire),
+	};
+}
+
+void tr::ConcurrentArena::rewind(ArenaCheckpoint checkpoint)
+{
+	// make sure the checkpoint makes sense before freeing anything
+	ArenaPage* current = _current.load();
+	ArenaPage* page = current;
+	while (page != checkpoint.page && page != nullptr) {
+		page = page->prev;
+	}
+	bool page_found = page == checkpoint.page;
+
+	page = _big_pages.load();
+	while (page != checkpoint.big_pages && page != nullptr) {
+		page = page->next;
+	}
+	bool big_page_found = page == checkpoint.big_pages;
+
+	bool pos_valid = checkpoint.page == nullptr || checkpoint.page != current ||
+			 checkpoint.pos <= current->alloc_pos;
+	if (!page_found || !big_page_found || !pos_valid) [[unlikely]] {
+		tr::panic(
+			"can't rewind to a checkpoint from another arena, or one that was already "
+			"rewound/reset past"
+		);
+	}
+
+	_call_destructors_until(checkpoint.destructors);
+
+	page = _big_pages.exchange(checkpoint.big_pages);
+	while (page != checkpoint.big_pages) {
+		ArenaPage* next = page->next;
+		_atomic_capacity -= page->bufsize;
+		_atomic_pages--;
+		tr::_tr::free_arena_page(_settings, page);
+		page = next;
+	}
+
+	// pages made after the checkpoint can't be kept around without a list of leftovers, so
+	// they just go back to the page pool
+	page = _current.exchange(checkpoint.page);
+	while (page != checkpoint.page) {
+		ArenaPage* prev = page->prev;
+		_atomic_capacity -= page->bufsize;
+		_atomic_pages--;
+		tr::_tr::free_arena_page(_settings, page);
+		page = prev;
+	}
+
+	if (checkpoint.page != nullptr) {
+		page = checkpoint.page;
+		if (_settings.zero_initialize && page->alloc_pos > checkpoint.pos) {
+			byte* start = static_cast<byte*>(page->buffer) + checkpoint.pos;
+			std::memset(start, 0, page->alloc_pos - checkpoint.pos);
+		}
+		page->alloc_pos = checkpoint.pos;
+	}
+
+	_atomic_allocated = checkpoint.allocated;
+	_stats_sync();
+}
+
+void tr::ConcurrentArena::_push_destructor(DestructorCall* call)
+{
+	std::atomic_ref<DestructorCall*> head{_destructors};
+	call->next = head.load(std::memory_order_relaxed);
+	while (!head.compare_exchange_weak(
+		call->next, call, std::memory_order_release, std::memory_order_relaxed
+	)) {
+	}
+}
+
+void tr::ConcurrentArena::free()
+{
+	_call_destructors();
+
+	ArenaPage* page = _big_pages.exchange(nullptr);
+	while (page != nullptr) {
+		ArenaPage* next = page->next;
+		tr::_tr::free_arena_page(_settings, page);
+		page = next;
+	}
+
+	page = _current.exchange(nullptr);
+	while (page != nullptr) {
+		ArenaPage* prev = page->prev;
+		tr::_tr::free_arena_page(_settings, page);
+		page = prev;
+	}
+
+	_stats_unregister();
+
+	// so it can be used again without exploding
+	_atomic_allocated = 0;
+	_atomic_capacity = 0;
+	_atomic_pages = 0;
+}
+
+void tr::ConcurrentArena::reset()
+{
+	_call_destructors();
+
+	ArenaPage* page = _big_pages.exchange(nullptr);
+	while (page != nullptr) {
+		ArenaPage* next = page->next;
+		tr::_tr::free_arena_page(_settings, page);
+		page = next;
+	}
+
+	// keep the newest page, everything before it goes
+	ArenaPage* current = _current.load();
+	if (current == nullptr) {
+		_atomic_allocated = 0;
+		_atomic_capacity = 0;
+		_atomic_pages = 0;
+		_stats_reset();
+		return;
+	}
+
+	page = current->prev;
+	while (page != nullptr) {
+		ArenaPage* prev = page->prev;
+		tr::_tr::free_arena_page(_settings, page);
+		page = prev;
+	}
+	current->prev = nullptr;
+
+	if (_settings.zero_initialize) {
+		std::memset(current->buffer, 0, current->alloc_pos);
+	}
+	current->alloc_pos = 0;
+
+	_atomic_allocated = 0;
+	_atomic_capacity = current->bufsize;
+	_atomic_pages = 1;
+	_stats_reset();
+}
+
+usize tr::ConcurrentArena::allocated() const
+{
+	return _atomic_allocated.load(std::memory_order_relaxed);
+}
+
+usize tr::ConcurrentArena::capacity() const
+{
+	return _atomic_capacity.load(std::memory_order_relaxed);
+}
+
+usize tr::ConcurrentArena::pages() const
+{
+	return _atomic_pages.load(std::memory_order_relaxed);
+}
+
 tr::WrapArena::WrapArena(usize size)
 	: Arena(ArenaSettings{
 		  .page_size = size,
@@ -288,8 +1127,10 @@ void* tr::WrapArena::alloc(usize size, usize align)
 {
 	TR_ASSERT(_page);
 
+	usize pos = _page->alloc_pos;
 	void* ptr = _page->alloc(size, align);
 	if (ptr != nullptr) {
+		_stats_alloc(size, _page->alloc_pos - pos - size);
 		return ptr;
 	}
 
@@ -301,10 +1142,99 @@ void* tr::WrapArena::alloc(usize size, usize align)
 	// TODO slowly poison the memory which is about to be overwritten
 	// for now i can't be bothered
 	_page->alloc_pos = 0;
-	return _page->alloc(size, align);
+	ptr = _page->alloc(size, align);
+	_stats_alloc(size, _page->alloc_pos - size);
+	_stats_fallback();
+	return ptr;
 }
 
 tr::Arena& tr::scratchpad()
 {
 	return tr::_the_real_scratchpad;
 }
+
+void tr::log_arena_stats(ArenaStatsFormat format)
+{
+#ifdef TR_ARENA_STATS
+	struct Snapshot
+	{
+		const char* name;
+		ArenaStats stats;
+		usize allocated;
+		usize capacity;
+		usize pages;
+	};
+
+	// copy everything first so the registry isn't locked while logging (which could make
+	// arenas). the arenas can be in use on other threads, so this only reads atomics
+	Snapshot* snapshots = nullptr;
+	usize len = 0;
+	{
+		std::lock_guard<std::mutex> lock{_arena_registry_mutex};
+		len = _arena_registry_len;
+		usize size = tr::max(len, usize{1}) * sizeof(Snapshot);
+		snapshots = static_cast<Snapshot*>(std::malloc(size));
+		TR_ASSERT_MSG(snapshots != nullptr, "couldn't allocate arena stats");
+		for (usize i = 0; i < len; i++) {
+			Arena* arena = _arena_registry[i];
+			snapshots[i] = {
+				.name = arena->name() != nullptr ? arena->name() : "(unnamed)",
+				.stats = arena->stats(),
+				.allocated = std::atomic_ref<usize>(arena->_seen_allocated)
+						     .load(std::memory_order_relaxed),
+				.capacity = std::atomic_ref<usize>(arena->_seen_capacity)
+						    .load(std::memory_order_relaxed),
+				.pages = std::atomic_ref<usize>(arena->_seen_pages)
+						 .load(std::memory_order_relaxed),
+			};
+		}
+	}
+
+	if (format == ArenaStatsFormat::TABLE) {
+		tr::log("arena stats (%zu arenas):", len);
+		tr::log(
+			"%-16s %12s %12s %12s %10s %6s %12s %7s %9s", "name", "allocated",
+			"capacity", "requested", "padding", "pages", "peak", "resets", "fallbacks"
+		);
+		for (usize i = 0; i < len; i++) {
+			const Snapshot& s = snapshots[i];
+			tr::log(
+				"%-16s %12zu %12zu %12zu %10zu %6zu %12zu %7zu %9zu", s.name,
+				s.allocated, s.capacity, s.stats.requested, s.stats.padding,
+				s.pages, s.stats.peak, s.stats.resets, s.stats.fallbacks
+			);
+		}
+	}
+	else {
+		ScratchArena scratch{};
+		StringBuilder json{scratch, "{\"arenas\": ["};
+		for (usize i = 0; i < len; i++) {
+			const Snapshot& s = snapshots[i];
+			json.append(i == 0 ? "{\"name\": \"" : ", {\"name\": \"");
+			// names are usually just literals but you never know
+			for (const char* c = s.name; *c != '\0'; c++) {
+				if (*c == '"' || *c == '\\') {
+					json.append('\\');
+				}
+				json.append(*c);
+			}
+			json.appendf(
+				"\", \"allocated\": %zu, \"capacity\": %zu, \"requested\": "
+				"%zu, \"padding\": %zu, \"pages\": %zu, \"pages_made\": %zu, "
+				"\"peak\": %zu, \"resets\": %zu, \"fallbacks\": %zu}",
+				s.allocated, s.capacity, s.stats.requested, s.stats.padding,
+				s.pages, s.stats.pages_made, s.stats.peak, s.stats.resets,
+				s.stats.fallbacks
+			);
+		}
+		json.append("]}");
+		tr::log("%s", *json);
+		scratch.free();
+	}
+
+	std::free(snapshots);
+#else
+	(void)format;
+	tr::warn("arena stats are disabled, compile libtrippin with -DTR_ARENA_STATS");
+#endif
+}
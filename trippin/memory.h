@@ -26,6 +26,8 @@
 #ifndef _TRIPPIN_MEMORY_H
 #define _TRIPPIN_MEMORY_H
 
+#include <atomic>
+#include <cstring>
 #include <initializer_list>
 #include <new> // IWYU pragma: keep
 #include <type_traits>
@@ -69,21 +71,119 @@ static constexpr usize bytes_to_gb(usize x)
 	return tr::bytes_to_mb(x) / 1024;
 }
 
-// memcpy is evil and breaks vtables :(
+// memcpy is evil and breaks vtables :( but anything trivially copyable doesn't have a vtable so
+// it's fine
 template<typename T>
 requires(!std::is_const_v<T>)
-constexpr void _copy_items(RefWrapper<T>* dst, const RefWrapper<T>* src, usize len)
+constexpr bool _memcpy_items(RefWrapper<T>* dst, const RefWrapper<T>* src, usize len)
 {
-	for (usize i = 0; i < len; i++) {
-		if constexpr (std::is_reference_v<T> || std::is_trivially_copyable_v<T>) {
+	if constexpr (std::is_reference_v<T> || std::is_trivially_copyable_v<T>) {
+		// memcpy isn't constexpr
+		if (!std::is_constant_evaluated()) {
+			std::memcpy(dst, src, len * sizeof(RefWrapper<T>));
+			return true;
+		}
+		for (usize i = 0; i < len; i++) {
 			dst[i] = src[i];
 		}
-		else {
+		return true;
+	}
+	return false;
+}
+
+// copies items into uninitialized memory, e.g. a buffer that was just allocated. if there's
+// already items there use `_copy_assign_items`, otherwise they never get destructed
+template<typename T>
+requires(!std::is_const_v<T>)
+constexpr void _copy_construct_items(RefWrapper<T>* dst, const RefWrapper<T>* src, usize len)
+{
+	if (!tr::_memcpy_items<T>(dst, src, len)) {
+		for (usize i = 0; i < len; i++) {
 			new (&dst[i]) T(src[i]);
 		}
 	}
 }
 
+// copies items over items that already exist
+template<typename T>
+requires(!std::is_const_v<T>)
+constexpr void _copy_assign_items(RefWrapper<T>* dst, const RefWrapper<T>* src, usize len)
+{
+	if (!tr::_memcpy_items<T>(dst, src, len)) {
+		for (usize i = 0; i < len; i++) {
+			dst[i] = src[i];
+		}
+	}
+}
+
+// same as `_copy_construct_items` but it moves instead, for when the old items aren't gonna be
+// used anymore
+template<typename T>
+requires(!std::is_const_v<T>)
+constexpr void _move_construct_items(RefWrapper<T>* dst, RefWrapper<T>* src, usize len)
+{
+	if (!tr::_memcpy_items<T>(dst, src, len)) {
+		for (usize i = 0; i < len; i++) {
+			new (&dst[i]) T(std::move(src[i]));
+		}
+	}
+}
+
+// same as `_copy_assign_items` but it moves instead
+template<typename T>
+requires(!std::is_const_v<T>)
+constexpr void _move_assign_items(RefWrapper<T>* dst, RefWrapper<T>* src, usize len)
+{
+	if (!tr::_memcpy_items<T>(dst, src, len)) {
+		for (usize i = 0; i < len; i++) {
+			dst[i] = std::move(src[i]);
+		}
+	}
+}
+
+// Pages between these sizes are recycled through a global page pool instead of going back to
+// malloc, see `ArenaSettings.use_page_pool`
+constexpr usize PAGE_POOL_MIN_PAGE = tr::kb_to_bytes(4);
+constexpr usize PAGE_POOL_MAX_PAGE = tr::mb_to_bytes(1);
+// How many bytes worth of pages the global page pool keeps around before it starts freeing them
+constexpr usize PAGE_POOL_MAX_BYTES = tr::mb_to_bytes(64);
+
+// Arena statistics are only recorded if libtrippin (and your code, since it changes the size of
+// `tr::Arena`) is compiled with `-DTR_ARENA_STATS`. Otherwise all of it compiles away.
+#ifdef TR_ARENA_STATS
+constexpr bool ARENA_STATS = true;
+#else
+constexpr bool ARENA_STATS = false;
+#endif
+
+// Statistics for an arena, see `tr::ARENA_STATS`. Always zero if that's disabled.
+struct ArenaStats
+{
+	// How many bytes were asked for over the arena's lifetime
+	usize requested = 0;
+	// How many bytes were wasted on alignment
+	usize padding = 0;
+	// How many pages/blocks were made over the arena's lifetime (`pages()` is how many it has
+	// right now)
+	usize pages_made = 0;
+	// The most bytes that were allocated at the same time
+	usize peak = 0;
+	// How many times the arena was reset
+	usize resets = 0;
+	// How many allocations didn't fit in the current page/block and had to get a new one
+	usize fallbacks = 0;
+};
+
+// How `tr::log_arena_stats()` prints it
+enum class ArenaStatsFormat : uint8
+{
+	TABLE,
+	JSON,
+};
+
+// Logs the stats of every arena that's alive and has allocated something, see `tr::ARENA_STATS`.
+void log_arena_stats(ArenaStatsFormat format = ArenaStatsFormat::TABLE);
+
 // Settings for an arena. How incredible.
 struct ArenaSettings
 {
@@ -93,6 +193,16 @@ struct ArenaSettings
 		RETURN_NULL
 	};
 
+	enum class GrowthPolicy : uint8
+	{
+		// Every page is `page_size` (unless the allocation doesn't fit)
+		FIXED,
+		// Each page is twice as big as the last one, up to `max_page_size`
+		DOUBLE,
+		// `grow_func` decides
+		CALLBACK,
+	};
+
 	// Base size for the buffers, you can have more buffers or bigger buffers.
 	usize page_size = tr::kb_to_bytes(4);
 	// null = no limit (grows infinitely)
@@ -102,6 +212,34 @@ struct ArenaSettings
 	bool zero_initialize = true;
 	// What should happen on allocation errors
 	ErrorBehavior error_behavior = ArenaSettings::ErrorBehavior::PANIC;
+	// How many bytes worth of pages `reset()` keeps around so they can be reused, the first
+	// page is always kept. null = keep every page, which means an arena that gets reset every
+	// frame stops calling malloc once it reaches its working size.
+	Maybe<usize> max_retained_bytes = {};
+	// If set, instead of making pages the arena reserves this much address space up front and
+	// commits it as you allocate, so it's just one big linear buffer. `page_size` is how much
+	// gets committed at a time. Running out of the reserved space is the same as running out of
+	// pages.
+	Maybe<usize> reserve_size = {};
+	// How much committed memory `reset()` keeps in a reserved arena, everything above that is
+	// given back to the OS.
+	usize decommit_watermark = tr::mb_to_bytes(1);
+	// If true, pages up to `PAGE_POOL_MAX_PAGE` are taken from a global page pool and given
+	// back when the arena is done with them, so making and freeing arenas doesn't hit malloc
+	// every time. Their sizes get rounded up to a power of 2. Reserved arenas never use the
+	// pool.
+	bool use_page_pool = true;
+	// How big new pages are. With anything other than FIXED, an arena that ends up holding
+	// hundreds of MBs only needs a few pages to get there.
+	GrowthPolicy growth_policy = GrowthPolicy::FIXED;
+	// The biggest a page can get from `GrowthPolicy::DOUBLE`. Allocations bigger than that
+	// still get a page that fits them.
+	usize max_page_size = tr::mb_to_bytes(64);
+	// Used with `GrowthPolicy::CALLBACK`, gets how many pages the arena has and the size picked
+	// for the last page (0 if there's no pages), and returns the size for the next page.
+	usize (*grow_func)(usize pages, usize last_page_size) = nullptr;
+	// Shows up in `tr::log_arena_stats()`, null = unnamed
+	const char* name = nullptr;
 };
 
 // Arenas are made of many buffers.
@@ -113,10 +251,22 @@ public:
 	ArenaPage* prev = nullptr;
 	ArenaPage* next = nullptr;
 	void* buffer = nullptr;
+	// only used for reserved pages (see `ArenaSettings.reserve_size`), normal pages are always
+	// fully committed
+	bool reserved = false;
+	usize committed = 0;
+	usize commit_step = 0;
 
 	explicit ArenaPage(ArenaSettings settings, usize size);
 	void free();
 
+	// Commits memory in a reserved page so that it's usable up to `end` bytes. Returns false on
+	// failure.
+	bool commit(usize end);
+
+	// Gives memory in a reserved page back to the OS, keeping `keep` bytes committed.
+	void decommit(usize keep);
+
 	// Returns how much space left the page has
 	usize available_space() const;
 
@@ -135,6 +285,17 @@ struct DestructorCall
 	DestructorCall* next;
 };
 
+// A position in an arena, see `Arena::checkpoint()`
+struct ArenaCheckpoint
+{
+	ArenaPage* page = nullptr;
+	usize pos = 0;
+	DestructorCall* destructors = nullptr;
+	usize allocated = 0;
+	// only used by ConcurrentArena, for its pages made for big allocations
+	ArenaPage* big_pages = nullptr;
+};
+
 // An arena allocator that grows infinitely through pages. Good enough 90% of the time. Saucy.
 class Arena
 {
@@ -145,7 +306,7 @@ public:
 	{
 	}
 
-	virtual ~Arena() {} // shutu p
+	virtual ~Arena(); // shutu p
 
 	explicit Arena(ArenaSettings settings);
 
@@ -174,6 +335,20 @@ public:
 		return static_cast<T>(alloc(size, align));
 	}
 
+	// Tries to make an allocation bigger without moving it, which only works if it's the last
+	// thing allocated in the current page. Returns false if it can't, in which case nothing
+	// changes and you have to allocate again like a caveman.
+	virtual bool try_extend(void* ptr, usize old_size, usize new_size);
+
+	// Returns a marker for where the arena is right now, which you can go back to with
+	// `rewind()`. Useful for temporary crap on top of long-lived data.
+	virtual ArenaCheckpoint checkpoint() const;
+
+	// Frees everything allocated after the checkpoint, calling their destructors too. The pages
+	// are kept around to be reused. The checkpoint has to be from this arena, and you can't go
+	// back to a checkpoint that a `reset()` or another `rewind()` already went past.
+	virtual void rewind(ArenaCheckpoint checkpoint);
+
 	// Reuses the entire arena and sets everything to 0 :)
 	virtual void reset();
 
@@ -191,8 +366,7 @@ public:
 		auto* call = static_cast<DestructorCall*>(this->alloc(sizeof(DestructorCall)));
 		call->func = [](void* obj) -> void { static_cast<T*>(obj)->~T(); };
 		call->object = huh;
-		call->next = this->_destructors;
-		this->_destructors = call;
+		this->_push_destructor(call);
 
 		return *huh;
 	}
@@ -212,8 +386,7 @@ public:
 		auto* call = static_cast<DestructorCall*>(this->alloc(sizeof(DestructorCall)));
 		call->func = [](void* obj) { static_cast<T*>(obj)->~T(); };
 		call->object = obj;
-		call->next = this->_destructors;
-		this->_destructors = call;
+		this->_push_destructor(call);
 
 		return *obj;
 	}
@@ -233,8 +406,7 @@ public:
 		auto* call = static_cast<DestructorCall*>(this->alloc(sizeof(DestructorCall)));
 		call->func = [](void* obj) { static_cast<T*>(obj)->~T(); };
 		call->object = obj;
-		call->next = this->_destructors;
-		this->_destructors = call;
+		this->_push_destructor(call);
 
 		return obj;
 	}
@@ -245,6 +417,15 @@ public:
 	// Returns how many bytes the arena can hold before expanding, in bytes.
 	virtual usize capacity() const;
 
+	// Returns how many pages the arena has.
+	virtual usize pages() const;
+
+	// Returns the name from `ArenaSettings.name`, or null if it doesn't have one.
+	const char* name() const;
+
+	// Returns statistics for the arena. Always zero unless `tr::ARENA_STATS` is enabled.
+	ArenaStats stats() const;
+
 protected:
 	// inheritance based as a bit of a hack so i don't have to change Arena& to Allocator& or
 	// whatever everywhere, + all the allocators are arena-like anyway
@@ -252,24 +433,150 @@ protected:
 	usize _capacity = 0;
 	usize _allocated = 0;
 	usize _pages = 0;
+	// pages after the current page are leftovers from a reset, they're always empty
 	ArenaPage* _page = nullptr;
 	DestructorCall* _destructors = nullptr;
+	// the size the growth policy picked for the last page, which can be smaller than the actual
+	// page if the allocation didn't fit
+	usize _last_page_size = 0;
+
+#ifdef TR_ARENA_STATS
+	ArenaStats _stats = {};
+	bool _registered = false;
+	// copies of allocated(), capacity() and pages() made by the thread using the arena, since
+	// `tr::log_arena_stats()` can't read the regular counters from another thread
+	usize _seen_allocated = 0;
+	usize _seen_capacity = 0;
+	usize _seen_pages = 0;
+
+	friend void log_arena_stats(ArenaStatsFormat format);
+#endif
+
+	// all of these do nothing if arena stats are disabled. they're atomic so that
+	// ConcurrentArena doesn't explode
+	void _stats_alloc(usize size, usize padding);
+	void _stats_page();
+	void _stats_fallback();
+	void _stats_reset();
+	void _stats_register();
+	void _stats_unregister();
+	// updates the `_seen_*` copies, the other `_stats_*` functions already do this
+	void _stats_sync();
 
 	void _call_destructors();
+	// calls the destructors registered after `stop`, but not `stop` itself
+	void _call_destructors_until(DestructorCall* stop);
+
+	// adds a destructor to be called when the arena is freed/reset. virtual so that
+	// ConcurrentArena can do it atomically
+	virtual void _push_destructor(DestructorCall* call);
+
+	// moves a page left over from a reset that can fit that allocation right after the current
+	// page, then makes it the current page. returns false if there's no such page
+	bool _reuse_page(usize size, usize align);
+};
+
+// The size of a cache line, or at least a good enough guess. Used to keep things that different
+// threads write to from sharing a cache line and fighting over it.
+constexpr usize CACHE_LINE_SIZE = 64;
+
+// An arena that can be used from many threads at the same time without a mutex. Allocating is
+// just an atomic add on the current page, and when it fills up whichever thread gets there first
+// swaps in a new page. Note `free()` and `reset()` still aren't thread safe, nothing can be
+// allocating while you call those. Reserved arenas (`ArenaSettings.reserve_size`) aren't
+// supported.
+class ConcurrentArena : public Arena
+{
+public:
+	// :)
+	ConcurrentArena()
+		: ConcurrentArena(ArenaSettings{})
+	{
+	}
+
+	explicit ConcurrentArena(ArenaSettings settings);
+
+	// Frees the arena.
+	void free() override;
+
+	// Allocates some crap on the arena.
+	[[nodiscard, gnu::malloc]]
+	void* alloc(usize size, usize align = alignof(max_align_t)) TR_LIFETIMEBOUND override;
+
+	// Like `.alloc()` but without an `static_cast<T*>`. Mind-boggling. You're required to use a
+	// pointer so that it's not confused with `.make_ptr()`, this is the evil low-level version.
+	template<typename T>
+	requires std::is_pointer_v<T>
+	[[nodiscard, gnu::malloc]]
+	auto* alloc(usize size, usize align = alignof(std::remove_pointer_t<T>)) TR_LIFETIMEBOUND
+	{
+		return static_cast<T>(alloc(size, align));
+	}
+
+	// Tries to make an allocation bigger without moving it. With many threads this only works
+	// if nothing else has been allocated after it.
+	bool try_extend(void* ptr, usize old_size, usize new_size) override;
+
+	// Returns a marker for where the arena is right now, which you can go back to with
+	// `rewind()`. Nothing can be allocating while you do that.
+	ArenaCheckpoint checkpoint() const override;
+
+	// Frees everything allocated after the checkpoint, calling their destructors too. Pages
+	// made after the checkpoint go back to the page pool. Not thread safe, like `reset()`.
+	void rewind(ArenaCheckpoint checkpoint) override;
+
+	// Reuses the entire arena and sets everything to 0 :) Only the newest page is kept.
+	void reset() override;
+
+	// Returns how much has already been allocated in the arena, in bytes.
+	usize allocated() const override;
+
+	// Returns how many bytes the arena can hold before expanding, in bytes.
+	usize capacity() const override;
+
+	// Returns how many pages the arena has.
+	usize pages() const override;
+
+protected:
+	void _push_destructor(DestructorCall* call) override;
+
+private:
+	// only the current page is ever allocated from, the older ones are reached through `prev`
+	alignas(CACHE_LINE_SIZE) std::atomic<ArenaPage*> _current = nullptr;
+	// allocations too big for a normal page get their own page, which goes here (linked through
+	// `next`)
+	std::atomic<ArenaPage*> _big_pages = nullptr;
+	// the regular counters would be a data race
+	alignas(CACHE_LINE_SIZE) std::atomic<usize> _atomic_allocated = 0;
+	std::atomic<usize> _atomic_capacity = 0;
+	std::atomic<usize> _atomic_pages = 0;
+
+	// returns null if it can't make a page (and the settings say not to panic)
+	ArenaPage* _new_page(usize size);
 };
 
 // This is a page size (it can use multiple pages)
 constexpr usize SCRATCH_BACKING_BUFFER_SIZE = tr::mb_to_bytes(4);
 
+// How many scratch stacks each thread gets, see `ScratchArena(const Arena& conflict)`
+constexpr usize SCRATCH_STACKS = 2;
+
 // Looks like an arena, can be passed as an arena, but is actually not really, instead it shares a
 // buffer with other ScratchArenas so that it can be used for temporary allocations with pratically
-// zero overhead. It works a lot like the stack, except it can't overflow.
+// zero overhead. It works a lot like the stack, except it can't overflow: freeing a scratch arena
+// goes back to wherever the buffer was when it was created, so they have to be freed in the
+// opposite order they were made in.
 class ScratchArena : public Arena
 {
 public:
 	// :)
 	ScratchArena();
 
+	// Makes a scratch arena that doesn't share its buffer with `conflict`. Use this when a
+	// function takes an arena for its result, since that arena could be a scratch arena too,
+	// and freeing your temporary scratch arena would free the result along with it.
+	explicit ScratchArena(const Arena& conflict);
+
 	// Frees the arena.
 	void free() override;
 
@@ -287,6 +594,18 @@ public:
 		return static_cast<T>(alloc(size, align));
 	}
 
+	// Tries to make an allocation bigger without moving it. Only works on the last thing
+	// allocated, and only if no scratch arena was made after this one.
+	bool try_extend(void* ptr, usize old_size, usize new_size) override;
+
+	// Returns a marker for where the arena is right now, which you can go back to with
+	// `rewind()`.
+	ArenaCheckpoint checkpoint() const override;
+
+	// Frees everything allocated after the checkpoint, calling their destructors too. Any
+	// scratch arena made after the checkpoint must be freed first.
+	void rewind(ArenaCheckpoint checkpoint) override;
+
 	// Does the same as freeing the arena then making a new one
 	void reset() override;
 
@@ -294,12 +613,23 @@ public:
 	usize allocated() const override;
 
 	// Returns the size of the underlying buffer. Note these can still expand (like a regular
-	// arena does), you can allocate more than whatever this returns.
+	// arena does), you can allocate more than whatever this returns. From another thread it's
+	// only as new as the arena's last allocation.
 	usize capacity() const override;
 
 private:
-	byte* _start_pos = nullptr;
-	Arena _fallback_arena{};
+	uint8 _stack = 0;
+	// the thread's scratch stacks, to know if capacity() is being called from another thread
+	const void* _owner = nullptr;
+	// null if the stack didn't have anything yet, which means the start of the stack
+	ArenaPage* _start_page = nullptr;
+	usize _start_pos = 0;
+	// used to know if this is the newest scratch arena in the stack, see `try_extend()`
+	uint64 _id = 0;
+	uint64 _prev_top = 0;
+
+	// goes back to that position in the stack
+	void _rewind(ArenaPage* page, usize pos);
 };
 
 // An arena that wraps around once it's joever. Really just used for `tr::tmp_fmt`'s implementation.
@@ -334,6 +664,22 @@ public:
 [[deprecated("use tr::ScratchArena or, tr::tmp_fmt for strings")]]
 Arena& scratchpad();
 
+// How arrays check for invalid indexes, set it with `-DTR_BOUNDS_CHECK=...` when compiling
+// libtrippin and your code. The default is `TR_BOUNDS_CHECK_ALWAYS`, and with
+// `TR_BOUNDS_CHECK_OFF` indexing an array is the same as indexing a pointer, for better and for
+// worse.
+#define TR_BOUNDS_CHECK_OFF 0
+#define TR_BOUNDS_CHECK_DEBUG 1
+#define TR_BOUNDS_CHECK_ALWAYS 2
+
+#ifndef TR_BOUNDS_CHECK
+	#define TR_BOUNDS_CHECK TR_BOUNDS_CHECK_ALWAYS
+#endif
+
+// If true, arrays check every index, see `TR_BOUNDS_CHECK`
+constexpr bool BOUNDS_CHECK = TR_BOUNDS_CHECK == TR_BOUNDS_CHECK_ALWAYS ||
+			      (TR_BOUNDS_CHECK == TR_BOUNDS_CHECK_DEBUG && tr::is_debug());
+
 // This is just for iterators
 template<typename T>
 struct ArrayItem
@@ -347,6 +693,74 @@ struct ArrayItem
 #include "trippin/bits/state.h"
 namespace tr {
 
+// A view into an array that was already checked when it was made, so indexing it is the same
+// as indexing a pointer (except on debug builds, where it still checks). Iterating over it also
+// gives you the items directly instead of `ArrayItem<T>`. Don't keep it around after the array
+// grows, since it points to the old buffer.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class Span
+{
+	T* _ptr = nullptr;
+	usize _len = 0;
+
+public:
+	using Type = T;
+
+	constexpr Span() {}
+
+	constexpr Span(T* ptr, usize len)
+		: _ptr(ptr)
+		, _len(len)
+	{
+		if (ptr == nullptr && len > 0) [[unlikely]] {
+			tr::panic("tr::Span<T> can't be null");
+		}
+	}
+
+	constexpr operator Span<const T>() const
+	requires(!std::is_const_v<T>)
+	{
+		return {_ptr, _len};
+	}
+
+	constexpr T& operator[](usize idx) const
+	{
+		if constexpr (BOUNDS_CHECK && tr::is_debug()) {
+			if (idx >= _len) [[unlikely]] {
+				tr::panic(
+					"index out of range: span[%zu] when the length is %zu", idx,
+					_len
+				);
+			}
+		}
+		return _ptr[idx];
+	}
+
+	constexpr T* buf() const
+	{
+		return _ptr;
+	}
+	constexpr usize len() const
+	{
+		return _len;
+	}
+	constexpr T* operator*() const
+	{
+		return _ptr;
+	}
+
+	// it's just pointers, the compiler knows what to do with that
+	constexpr T* begin() const
+	{
+		return _ptr;
+	}
+	constexpr T* end() const
+	{
+		return _ptr + _len;
+	}
+};
+
 // man
 enum class ArrayClearBehavior
 {
@@ -387,8 +801,75 @@ class Array
 
 	constexpr void _validate() const
 	{
-		if (_ptr == nullptr) [[unlikely]] {
-			tr::panic("uninitialized tr::Array<T>!");
+		if constexpr (BOUNDS_CHECK) {
+			if (_ptr == nullptr) [[unlikely]] {
+				tr::panic("uninitialized tr::Array<T>!");
+			}
+		}
+	}
+
+	constexpr void _check_index(usize idx) const
+	{
+		if constexpr (!BOUNDS_CHECK) {
+			return;
+		}
+
+		_validate();
+		if (idx >= _len) [[unlikely]] {
+			tr::panic(
+				"index out of range: array[%zu] when the length is %zu", idx, _len
+			);
+		}
+	}
+
+	// no checks, be careful
+	constexpr T& _item(usize idx) const
+	{
+		// oh dear
+		if constexpr (std::is_const_v<T>) {
+			if constexpr (std::is_reference_v<T>) {
+				return *_ptr[idx];
+			}
+			else {
+				return _ptr[idx];
+			}
+		}
+		else {
+			if constexpr (std::is_reference_v<T>) {
+				return *_arena_ptr[idx];
+			}
+			else {
+				return _arena_ptr[idx];
+			}
+		}
+	}
+
+	void _check_can_grow() const
+	{
+		_validate();
+		if (!_can_grow || _src_arena == nullptr) [[unlikely]] {
+			tr::panic("array can't grow (likely not allocated from arena)");
+		}
+	}
+
+	// makes the buffer bigger, in place if the arena can do that, otherwise it has to
+	// reallocate and copy everything
+	void _grow(usize new_cap)
+	requires(!std::is_const_v<T>)
+	{
+		usize old_size = _cap * sizeof(MutT);
+		if (_src_arena->try_extend(_arena_ptr, old_size, new_cap * sizeof(MutT))) {
+			_cap = new_cap;
+			return;
+		}
+
+		MutT* old_buffer = _arena_ptr;
+		_cap = new_cap;
+		_arena_ptr = _src_arena->alloc<MutT*>(_cap * sizeof(MutT));
+
+		// you may initialize with a length of 0 so you can then add crap later
+		if (_len > 0) {
+			tr::_move_construct_items<MutT>(_arena_ptr, old_buffer, _len);
 		}
 	}
 
@@ -410,7 +891,7 @@ public:
 			_cap = ARRAY_INITIAL_CAPACITY;
 		}
 
-		_arena_ptr = static_cast<MutT*>(arena.alloc(sizeof(T) * _cap));
+		_arena_ptr = static_cast<MutT*>(arena.alloc(sizeof(MutT) * _cap));
 
 		// arena memory isn't always zero-initialized
 		if constexpr (std::is_reference_v<T>) {
@@ -451,12 +932,12 @@ public:
 			);
 		}
 
-		_arena_ptr = static_cast<MutT*>(arena.alloc(sizeof(T) * _cap));
+		_arena_ptr = static_cast<MutT*>(arena.alloc(sizeof(MutT) * _cap));
 		if (len == 0) {
 			return;
 		}
 
-		tr::_copy_items<MutT>(_arena_ptr, data, len);
+		tr::_copy_construct_items<MutT>(_arena_ptr, data, len);
 	}
 
 	// Initializes an array that points to any buffer. You really should only use
@@ -519,24 +1000,7 @@ public:
 		if (idx >= _len) {
 			return {};
 		}
-
-		// oh dear
-		if constexpr (std::is_const_v<T>) {
-			if constexpr (std::is_reference_v<T>) {
-				return *_ptr[idx];
-			}
-			else {
-				return _ptr[idx];
-			}
-		}
-		else {
-			if constexpr (std::is_reference_v<T>) {
-				return *_arena_ptr[idx];
-			}
-			else {
-				return _arena_ptr[idx];
-			}
-		}
+		return _item(idx);
 	}
 
 	// Similar to `operator[]`, but when getting an index out of bounds, instead
@@ -548,46 +1012,19 @@ public:
 		if (idx >= _len) {
 			return {};
 		}
-
-		// oh dear
-		if constexpr (std::is_const_v<T>) {
-			if constexpr (std::is_reference_v<T>) {
-				return *_ptr[idx];
-			}
-			else {
-				return _ptr[idx];
-			}
-		}
-		else {
-			if constexpr (std::is_reference_v<T>) {
-				return *_arena_ptr[idx];
-			}
-			else {
-				return _arena_ptr[idx];
-			}
-		}
+		return _item(idx);
 	}
 
 	constexpr const T& operator[](usize idx) const
 	{
-		_validate();
-
-		Maybe<const T&> item = try_get(idx);
-		if (item.is_valid()) {
-			return item.unwrap();
-		}
-		tr::panic("index out of range: array[%zu] when the length is %zu", idx, _len);
+		_check_index(idx);
+		return _item(idx);
 	}
 
 	constexpr T& operator[](usize idx)
 	{
-		_validate();
-
-		Maybe<T&> item = try_get(idx);
-		if (item.is_valid()) {
-			return item.unwrap();
-		}
-		tr::panic("index out of range: array[%zu] when the length is %zu", idx, _len);
+		_check_index(idx);
+		return _item(idx);
 	}
 
 	// Returns the buffer.
@@ -614,12 +1051,30 @@ public:
 		_validate();
 		return _cap;
 	}
+	// Returns the arena the array was allocated in, or null if it's just pointing somewhere.
+	constexpr Maybe<Arena&> arena() const
+	{
+		if (_src_arena == nullptr) {
+			return {};
+		}
+		return *_src_arena;
+	}
 	// Shorthand for `.buf()`
 	constexpr RefWrapper<T>* operator*() const
 	{
 		return buf();
 	}
 
+	// Returns a view of the array that's only checked once, here, so that loops over it are as
+	// fast as loops over a pointer. It points to the current buffer, so it's invalid after
+	// the array grows.
+	constexpr Span<T> unchecked() const
+	requires(!std::is_reference_v<T>)
+	{
+		_validate();
+		return {buf(), _len};
+	}
+
 	// fucking iterator
 	class Iterator
 	{
@@ -672,40 +1127,53 @@ public:
 	// Adds a new item to the array, and resizes it if necessary. This only works
 	// on arena-allocated arrays, if you try to use this on an array without an
 	// arena, it will panic.
-	void add(T val)
+	void add(const T& val)
 	requires(!std::is_const_v<T>)
 	{
-		_validate();
-		if (!_can_grow || _src_arena == nullptr) [[unlikely]] {
-			tr::panic("array can't grow (likely not allocated from arena)");
-		}
-
-		// does it already fit?
-		if (_len < _cap) [[likely]] {
-			if constexpr (std::is_reference_v<T>) {
-				_arena_ptr[_len++] = &val;
-			}
-			else {
-				new (&_arena_ptr[_len++]) T(val);
+		if constexpr (std::is_reference_v<T>) {
+			_check_can_grow();
+			if (_len >= _cap) [[unlikely]] {
+				_grow(_cap * 2);
 			}
-			return;
+			_arena_ptr[_len++] = &val;
+		}
+		else {
+			emplace(val);
 		}
+	}
 
-		// reallocate array
-		MutT* old_buffer = _arena_ptr;
-		_cap *= 2;
-		_arena_ptr = _src_arena->alloc<MutT*>(_cap * sizeof(T));
+	// Adds a new item to the array, and resizes it if necessary. Same as the other `add()`
+	// but it moves the item instead of copying it.
+	void add(T&& val)
+	requires(!std::is_const_v<T> && !std::is_reference_v<T>)
+	{
+		emplace(std::move(val));
+	}
 
-		// you may initialize with a length of 0 so you can then add crap later
-		if (_len > 0) {
-			tr::_copy_items<MutT>(_arena_ptr, old_buffer, _len);
+	// Constructs a new item at the end of the array, and resizes it if necessary. Good for
+	// when the items are big and you don't wanna copy them around.
+	template<typename... Args>
+	T& emplace(Args&&... args)
+	requires(!std::is_const_v<T> && !std::is_reference_v<T>)
+	{
+		_check_can_grow();
+
+		// does it already fit?
+		if (_len < _cap) [[likely]] {
+			return *new (&_arena_ptr[_len++]) T(std::forward<Args>(args)...);
 		}
 
-		if constexpr (std::is_reference_v<T>) {
-			_arena_ptr[_len++] = &val;
+		// the arguments could be pointing to the old buffer, which gets moved from when
+		// growing, so make the item first. if it's trivially copyable the old buffer is
+		// left alone so it's fine
+		if constexpr (std::is_trivially_copyable_v<T>) {
+			_grow(_cap * 2);
+			return *new (&_arena_ptr[_len++]) T(std::forward<Args>(args)...);
 		}
 		else {
-			new (&_arena_ptr[_len++]) T(val);
+			T item(std::forward<Args>(args)...);
+			_grow(_cap * 2);
+			return *new (&_arena_ptr[_len++]) T(std::move(item));
 		}
 	}
 
@@ -715,10 +1183,7 @@ public:
 	void reserve(usize items)
 	requires(!std::is_const_v<T>)
 	{
-		_validate();
-		if (!_can_grow || _src_arena == nullptr) [[unlikely]] {
-			tr::panic("array can't grow (likely not allocated from arena)");
-		}
+		_check_can_grow();
 		// just in case the math blows up or some shit
 		if (items == 0) [[unlikely]] {
 			return;
@@ -729,15 +1194,7 @@ public:
 			return;
 		}
 
-		// reallocate array
-		MutT* old_buffer = _arena_ptr;
-		_cap = tr::max(_cap * 2, _cap + items);
-		_arena_ptr = _src_arena->alloc<MutT*>(_cap * sizeof(T));
-
-		// you may initialize with a length of 0 so you can then add crap later
-		if (_len > 0) {
-			tr::_copy_items<MutT>(_arena_ptr, old_buffer, _len);
-		}
+		_grow(tr::max(_cap * 2, _cap + items));
 
 		// initialize the new items so nothing evil happens
 		for (usize i = _len; i < _len + items; i++) {
@@ -796,7 +1253,7 @@ public:
 	constexpr List(std::initializer_list<const T> initlist)
 	{
 		static_assert(initlist.size() <= N, "you buffoon the sizes don't match");
-		tr::_copy_items<T>(_array, initlist.begin(), initlist.size());
+		tr::_copy_assign_items<T>(_array, initlist.begin(), initlist.size());
 	}
 
 	constexpr Maybe<const T&> try_get(usize idx) const TR_LIFETIMEBOUND
@@ -912,6 +1369,832 @@ public:
 	}
 };
 
+// Handle to an item in a `tr::Pool<T>`. Unlike a pointer, it knows when the item was freed, even
+// if the slot has been reused for something else since then.
+struct PoolHandle
+{
+	uint32 index = 0;
+	// 0 is never valid, so a zero-initialized handle doesn't point to anything
+	uint32 generation = 0;
+
+	constexpr bool operator==(const PoolHandle& other) const = default;
+};
+
+// How many slots pools get at a time by default
+constexpr usize POOL_CHUNK_LEN = 64;
+
+// A pool of fixed-size slots, for objects that get made and freed individually all the time
+// (which arenas suck at). Making and freeing are both O(1) through a free list. The slots come from
+// an arena in chunks, so you can still free everything at once by freeing the arena. Note that
+// unlike arrays, pools have state, so pass them by reference.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class Pool
+{
+	struct Slot
+	{
+		// when the slot is free this has a pointer to the next free slot instead
+		alignas(T) alignas(void*) byte storage[tr::max(sizeof(T), sizeof(void*))];
+		uint32 index;
+		uint32 generation;
+		bool alive;
+	};
+
+	Arena* _arena = nullptr;
+	Slot** _chunks = nullptr;
+	usize _chunk_count = 0;
+	usize _chunk_table_cap = 0;
+	usize _chunk_len = 0;
+	// how many slots have ever been used, the ones after that are untouched
+	usize _used = 0;
+	Slot* _free_list = nullptr;
+	usize _live = 0;
+	usize _peak = 0;
+
+	constexpr void _validate() const
+	{
+		if (_arena == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::Pool<T>!");
+		}
+	}
+
+	static Slot*& _next_free(Slot* slot)
+	{
+		return *reinterpret_cast<Slot**>(slot->storage);
+	}
+
+	Slot* _slot_at(usize index) const
+	{
+		return &_chunks[index / _chunk_len][index % _chunk_len];
+	}
+
+	void _add_chunk()
+	{
+		if (_chunk_count == _chunk_table_cap) {
+			// only this table of chunk pointers is copied, the chunks never move. so
+			// the free list (linked through the slots in the chunks) and every
+			// pointer handed out stay valid. the old table is left in the arena
+			usize new_cap = tr::max(_chunk_table_cap * 2, usize{8});
+			Slot** new_table = _arena->alloc<Slot**>(sizeof(Slot*) * new_cap);
+			if (_chunks != nullptr) {
+				std::memcpy(new_table, _chunks, sizeof(Slot*) * _chunk_count);
+			}
+			_chunks = new_table;
+			_chunk_table_cap = new_cap;
+		}
+
+		TR_ASSERT_MSG(
+			(_chunk_count + 1) * _chunk_len <= UINT32_MAX,
+			"tr::Pool<T> can't have that many items"
+		);
+		_chunks[_chunk_count] = _arena->alloc<Slot*>(sizeof(Slot) * _chunk_len);
+		_chunk_count++;
+	}
+
+	Slot* _take_slot()
+	{
+		if (_free_list != nullptr) {
+			Slot* slot = _free_list;
+			_free_list = _next_free(slot);
+			return slot;
+		}
+
+		if (_used == _chunk_count * _chunk_len) {
+			_add_chunk();
+		}
+		Slot* slot = _slot_at(_used);
+		slot->index = static_cast<uint32>(_used);
+		slot->generation = 1;
+		_used++;
+		return slot;
+	}
+
+	void _release_slot(Slot* slot)
+	{
+		reinterpret_cast<T*>(slot->storage)->~T();
+		slot->alive = false;
+		// so that old handles stop working
+		slot->generation++;
+		if (slot->generation == 0) {
+			slot->generation = 1;
+		}
+
+		_next_free(slot) = _free_list;
+		_free_list = slot;
+	}
+
+	// returns null if the handle is no longer valid
+	Slot* _slot_from_handle(PoolHandle handle) const
+	{
+		if (handle.index >= _used) {
+			return nullptr;
+		}
+		Slot* slot = _slot_at(handle.index);
+		if (!slot->alive || slot->generation != handle.generation) {
+			return nullptr;
+		}
+		return slot;
+	}
+
+public:
+	using Type = T;
+
+	constexpr Pool() {}
+
+	// Initializes a pool that gets its memory from an arena, `chunk_len` slots at a time.
+	explicit Pool(Arena& arena, usize chunk_len = POOL_CHUNK_LEN)
+		: _arena(&arena)
+		, _chunk_len(chunk_len)
+	{
+		TR_ASSERT_MSG(chunk_len != 0, "you doofus why would you make a pool of 0 items");
+	}
+
+	// Makes a new item in the pool. The funky variadic templates allow you to pass any
+	// arguments here to the actual constructor.
+	template<typename... Args>
+	[[nodiscard]]
+	T* make(Args&&... args) TR_LIFETIMEBOUND
+	{
+		_validate();
+
+		Slot* slot = _take_slot();
+		T* obj = new (slot->storage) T(std::forward<Args>(args)...);
+		slot->alive = true;
+
+		_live++;
+		_peak = tr::max(_peak, _live);
+		return obj;
+	}
+
+	// Calls the destructor and gives the slot back to the pool. Freeing the same thing twice
+	// panics.
+	void free(T* ptr)
+	{
+		_validate();
+		TR_ASSERT(ptr != nullptr);
+
+		// storage is the first member so they have the same address
+		Slot* slot = reinterpret_cast<Slot*>(ptr);
+		if (!slot->alive) [[unlikely]] {
+			tr::panic("double free in tr::Pool<T> (or the pointer isn't from a pool)");
+		}
+		_release_slot(slot);
+		_live--;
+	}
+
+	// Calls the destructor and gives the slot back to the pool. Panics if the handle is no
+	// longer valid.
+	void free(PoolHandle handle)
+	{
+		_validate();
+
+		Slot* slot = _slot_from_handle(handle);
+		if (slot == nullptr) [[unlikely]] {
+			tr::panic(
+				"tr::Pool<T> handle (index %u, generation %u) is no longer valid",
+				handle.index, handle.generation
+			);
+		}
+		_release_slot(slot);
+		_live--;
+	}
+
+	// Returns a handle to something made by this pool, which can tell when it was freed.
+	PoolHandle handle(const T* ptr) const
+	{
+		_validate();
+		TR_ASSERT(ptr != nullptr);
+
+		const Slot* slot = reinterpret_cast<const Slot*>(ptr);
+		TR_ASSERT_MSG(slot->alive, "can't get a handle to something that was freed");
+		return {.index = slot->index, .generation = slot->generation};
+	}
+
+	// Returns the item if the handle is still valid, or null if it was freed.
+	Maybe<T&> try_get(PoolHandle handle) const TR_LIFETIMEBOUND
+	{
+		_validate();
+
+		Slot* slot = _slot_from_handle(handle);
+		if (slot == nullptr) {
+			return {};
+		}
+		return *reinterpret_cast<T*>(slot->storage);
+	}
+
+	// Returns the item, or panics if it was freed.
+	T& operator[](PoolHandle handle) const TR_LIFETIMEBOUND
+	{
+		Maybe<T&> item = try_get(handle);
+		if (item.is_valid()) {
+			return item.unwrap();
+		}
+		tr::panic(
+			"tr::Pool<T> handle (index %u, generation %u) is no longer valid",
+			handle.index, handle.generation
+		);
+	}
+
+	// Returns how many items are currently alive in the pool.
+	constexpr usize live() const
+	{
+		return _live;
+	}
+
+	// Returns the most items that have ever been alive at the same time.
+	constexpr usize peak() const
+	{
+		return _peak;
+	}
+
+	// Returns how many items the pool can hold before getting more memory from the arena.
+	constexpr usize capacity() const
+	{
+		return _chunk_count * _chunk_len;
+	}
+
+	// Frees every item in the pool. The memory is kept around for new items.
+	void clear()
+	{
+		_validate();
+
+		// backwards so the first slots get reused first
+		_free_list = nullptr;
+		for (usize i = _used; i > 0; i--) {
+			Slot* slot = _slot_at(i - 1);
+			if (slot->alive) {
+				_release_slot(slot);
+			}
+			else {
+				_next_free(slot) = _free_list;
+				_free_list = slot;
+			}
+		}
+		_live = 0;
+	}
+};
+
+// How many items bucket arrays get at a time by default
+constexpr usize BUCKET_ARRAY_LEN = 64;
+
+// An array that grows by adding buckets of `BucketLen` items instead of reallocating, so items
+// never move and pointers to them stay valid forever (until you free the arena). Indexing is
+// still O(1), it's just a division and a modulo (which are shifts since `BucketLen` is a power of
+// 2). Removing items leaves a hole, which is reused by the next `add()`, so indexes don't change
+// either. Pass it by reference, copies share the buckets but not the length or the free list, so
+// adding to both hands out the same slot twice.
+template<typename T, usize BucketLen = BUCKET_ARRAY_LEN>
+requires(!std::is_reference_v<T> && BucketLen > 0 && (BucketLen & (BucketLen - 1)) == 0)
+class BucketArray
+{
+	struct Bucket
+	{
+		alignas(T) byte items[sizeof(T) * BucketLen];
+		// 1 bit per item, set if it's alive
+		uint64 alive[(BucketLen + 63) / 64];
+	};
+
+	Arena* _arena = nullptr;
+	Bucket** _buckets = nullptr;
+	usize _bucket_count = 0;
+	usize _bucket_table_cap = 0;
+	// how many slots have ever been used, the ones after that are untouched
+	usize _used = 0;
+	usize _len = 0;
+	// indexes of removed items, so they can be reused
+	usize* _free = nullptr;
+	usize _free_len = 0;
+	usize _free_cap = 0;
+
+	constexpr void _validate() const
+	{
+		if (_arena == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::BucketArray<T>!");
+		}
+	}
+
+	T* _item_at(usize idx) const
+	{
+		return reinterpret_cast<T*>(_buckets[idx / BucketLen]->items) + idx % BucketLen;
+	}
+
+	bool _is_alive(usize idx) const
+	{
+		usize bit = idx % BucketLen;
+		return (_buckets[idx / BucketLen]->alive[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	void _check_alive(usize idx) const
+	{
+		_validate();
+		if (idx >= _used || !_is_alive(idx)) [[unlikely]] {
+			tr::panic(
+				"tr::BucketArray<T> item %zu doesn't exist or was removed", idx
+			);
+		}
+	}
+
+	void _set_alive(usize idx, bool alive)
+	{
+		usize bit = idx % BucketLen;
+		uint64& word = _buckets[idx / BucketLen]->alive[bit / 64];
+		if (alive) {
+			word |= uint64{1} << (bit % 64);
+		}
+		else {
+			word &= ~(uint64{1} << (bit % 64));
+		}
+	}
+
+	void _add_bucket()
+	{
+		if (_bucket_count == _bucket_table_cap) {
+			// this is just the list of buckets, the buckets themselves stay put. the
+			// old list is left in the arena, it's 1 pointer per bucket so it's tiny
+			// next to the buckets
+			usize new_cap = tr::max(_bucket_table_cap * 2, usize{8});
+			Bucket** new_table = _arena->alloc<Bucket**>(sizeof(Bucket*) * new_cap);
+			if (_buckets != nullptr) {
+				std::memcpy(new_table, _buckets, sizeof(Bucket*) * _bucket_count);
+			}
+			_buckets = new_table;
+			_bucket_table_cap = new_cap;
+		}
+
+		auto* bucket = static_cast<Bucket*>(_arena->alloc(sizeof(Bucket), alignof(Bucket)));
+		// arena memory isn't always zero-initialized
+		std::memset(bucket->alive, 0, sizeof(bucket->alive));
+		_buckets[_bucket_count] = bucket;
+		_bucket_count++;
+	}
+
+	usize _take_index()
+	{
+		if (_free_len > 0) {
+			_free_len--;
+			return _free[_free_len];
+		}
+
+		if (_used == _bucket_count * BucketLen) {
+			_add_bucket();
+		}
+		return _used++;
+	}
+
+	void _push_free(usize idx)
+	{
+		if (_free_len == _free_cap) {
+			usize new_cap = tr::max(_free_cap * 2, usize{16});
+			usize old_size = _free_cap * sizeof(usize);
+			if (!_arena->try_extend(_free, old_size, new_cap * sizeof(usize))) {
+				usize* new_free = _arena->alloc<usize*>(sizeof(usize) * new_cap);
+				if (_free != nullptr) {
+					std::memcpy(new_free, _free, sizeof(usize) * _free_len);
+				}
+				_free = new_free;
+			}
+			_free_cap = new_cap;
+		}
+		_free[_free_len++] = idx;
+	}
+
+public:
+	using Type = T;
+
+	constexpr BucketArray() {}
+
+	// Initializes an empty bucket array that gets its memory from an arena.
+	explicit BucketArray(Arena& arena)
+		: _arena(&arena)
+	{
+	}
+
+	// Constructs a new item, reusing the slot of a removed item if there is one. Returns the
+	// index and the item, which never moves.
+	template<typename... Args>
+	ArrayItem<T&> emplace(Args&&... args) TR_LIFETIMEBOUND
+	{
+		_validate();
+
+		usize idx = _take_index();
+		T* item = new (_item_at(idx)) T(std::forward<Args>(args)...);
+		_set_alive(idx, true);
+		_len++;
+		return {idx, *item};
+	}
+
+	// Adds a new item, reusing the slot of a removed item if there is one. Returns the index
+	// and the item, which never moves.
+	ArrayItem<T&> add(const T& val) TR_LIFETIMEBOUND
+	{
+		return emplace(val);
+	}
+
+	// Adds a new item, reusing the slot of a removed item if there is one. Returns the index
+	// and the item, which never moves.
+	ArrayItem<T&> add(T&& val) TR_LIFETIMEBOUND
+	{
+		return emplace(std::move(val));
+	}
+
+	// Calls the destructor and leaves a hole that the next `add()` can use. Panics if the
+	// item was already removed.
+	void remove(usize idx)
+	{
+		_check_alive(idx);
+
+		_item_at(idx)->~T();
+		_set_alive(idx, false);
+		_push_free(idx);
+		_len--;
+	}
+
+	// Returns the item, or null if it's out of range or was removed.
+	Maybe<T&> try_get(usize idx) const TR_LIFETIMEBOUND
+	{
+		_validate();
+		if (idx >= _used || !_is_alive(idx)) {
+			return {};
+		}
+		return *_item_at(idx);
+	}
+
+	// Returns the item, or panics if it's out of range or was removed.
+	T& operator[](usize idx) const TR_LIFETIMEBOUND
+	{
+		if constexpr (BOUNDS_CHECK) {
+			_check_alive(idx);
+		}
+		return *_item_at(idx);
+	}
+
+	// Returns how many items are alive.
+	constexpr usize len() const
+	{
+		return _len;
+	}
+
+	// Returns how many items the bucket array can hold before getting more memory.
+	constexpr usize cap() const
+	{
+		return _bucket_count * BucketLen;
+	}
+
+	// Removes every item, calling their destructors. The buckets are kept around for new
+	// items.
+	void clear()
+	{
+		_validate();
+		for (usize i = 0; i < _used; i++) {
+			if (_is_alive(i)) {
+				_item_at(i)->~T();
+			}
+		}
+		for (usize i = 0; i < _bucket_count; i++) {
+			std::memset(_buckets[i]->alive, 0, sizeof(_buckets[i]->alive));
+		}
+		_used = 0;
+		_len = 0;
+		_free_len = 0;
+	}
+
+	// fucking iterator
+	class Iterator
+	{
+	public:
+		Iterator(const BucketArray* array, usize idx)
+			: _array(array)
+			, _idx(idx)
+		{
+			_find_valid();
+		}
+		ArrayItem<T&> operator*() const
+		{
+			return {_idx, *_array->_item_at(_idx)};
+		}
+		Iterator& operator++()
+		{
+			_idx++;
+			_find_valid();
+			return *this;
+		}
+		constexpr bool operator!=(const Iterator& other) const
+		{
+			return _idx != other._idx;
+		}
+
+	private:
+		const BucketArray* _array;
+		usize _idx;
+
+		void _find_valid()
+		{
+			// skip the holes
+			while (_idx < _array->_used && !_array->_is_alive(_idx)) {
+				_idx++;
+			}
+		}
+	};
+
+	Iterator begin() const
+	{
+		return Iterator(this, 0);
+	}
+	Iterator end() const
+	{
+		return Iterator(this, _used);
+	}
+};
+
+namespace _tr {
+	// std::tuple_element without std::tuple
+	template<usize I, typename T, typename... Rest>
+	struct NthType
+	{
+		using Type = typename NthType<I - 1, Rest...>::Type;
+	};
+
+	template<typename T, typename... Rest>
+	struct NthType<0, T, Rest...>
+	{
+		using Type = T;
+	};
+} // namespace _tr
+
+// An item from a `tr::SoaArray`, which is just the index and references to every field. Use it
+// with structured bindings, e.g. `auto [i, pos, vel] = soa[i]`
+template<typename... Fields>
+class SoaItem
+{
+	void* const* _columns;
+	usize _idx;
+
+public:
+	constexpr SoaItem(void* const* columns, usize idx)
+		: _columns(columns)
+		, _idx(idx)
+	{
+	}
+
+	// 0 is the index, the fields start at 1, like `tr::ArrayItem<T>`
+	template<usize I>
+	constexpr decltype(auto) get() const
+	{
+		if constexpr (I == 0) {
+			return usize{_idx};
+		}
+		else {
+			using Field = typename _tr::NthType<I - 1, Fields...>::Type;
+			return static_cast<Field&>(static_cast<Field*>(_columns[I - 1])[_idx]);
+		}
+	}
+};
+
+// Structure of arrays, so it's like an `Array<Struct>` but every field is in its own buffer.
+// Useful when you only need a few fields at a time, since you don't have to drag the rest of
+// the struct through the cache. All the columns are in the same arena and grow together.
+template<typename... Fields>
+requires(
+	sizeof...(Fields) > 0 && ((!std::is_reference_v<Fields> && !std::is_const_v<Fields>) && ...)
+)
+class SoaArray
+{
+public:
+	static constexpr usize COLUMNS = sizeof...(Fields);
+
+	// The type of the field at that index
+	template<usize I>
+	using Column = typename _tr::NthType<I, Fields...>::Type;
+
+private:
+	void* _columns[COLUMNS] = {};
+	Arena* _src_arena = nullptr;
+	usize _len = 0;
+	usize _cap = 0;
+
+	constexpr void _validate() const
+	{
+		if (_src_arena == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::SoaArray<Fields...>!");
+		}
+	}
+
+	template<usize I>
+	constexpr Column<I>* _column_ptr() const
+	{
+		return static_cast<Column<I>*>(_columns[I]);
+	}
+
+	template<usize I>
+	void _grow_column(usize new_cap)
+	{
+		using T = Column<I>;
+		if (_src_arena->try_extend(_columns[I], _cap * sizeof(T), new_cap * sizeof(T))) {
+			return;
+		}
+
+		T* old_buffer = _column_ptr<I>();
+		_columns[I] = _src_arena->alloc(new_cap * sizeof(T), alignof(T));
+		if (_len > 0) {
+			tr::_move_construct_items<T>(_column_ptr<I>(), old_buffer, _len);
+		}
+	}
+
+	void _grow(usize new_cap)
+	{
+		[&]<usize... Is>(std::index_sequence<Is...>) {
+			(_grow_column<Is>(new_cap), ...);
+		}(std::index_sequence_for<Fields...>{});
+		_cap = new_cap;
+	}
+
+public:
+	constexpr SoaArray() {}
+
+	// Initializes an empty array at an arena, so you can add crap later
+	explicit SoaArray(Arena& arena)
+		: SoaArray(arena, 0)
+	{
+	}
+
+	// Initializes an array with `len` items, with every field default-initialized
+	SoaArray(Arena& arena, usize len)
+		: _src_arena(&arena)
+		, _len(len)
+		, _cap(len == 0 ? ARRAY_INITIAL_CAPACITY : len)
+	{
+		[&]<usize... Is>(std::index_sequence<Is...>) {
+			((_columns[Is] = arena.alloc(_cap * sizeof(Fields), alignof(Fields))), ...);
+			(_init_column<Is>(0, len), ...);
+		}(std::index_sequence_for<Fields...>{});
+	}
+
+	// Adds a new item to the array, and resizes every column if necessary.
+	void add(Fields... fields)
+	{
+		_validate();
+		if (_len >= _cap) [[unlikely]] {
+			_grow(_cap * 2);
+		}
+
+		[&]<usize... Is>(std::index_sequence<Is...>) {
+			(new (&_column_ptr<Is>()[_len]) Fields(std::move(fields)), ...);
+		}(std::index_sequence_for<Fields...>{});
+		_len++;
+	}
+
+	// Reserves space for adding that many items later without resizing.
+	void reserve(usize items)
+	{
+		_validate();
+		if (_len + items > _cap) {
+			_grow(tr::max(_cap * 2, _len + items));
+		}
+	}
+
+	// Removes every item, but keeps the memory around.
+	void clear()
+	{
+		_validate();
+		_len = 0;
+	}
+
+	// Returns how many items there are
+	constexpr usize len() const
+	{
+		return _len;
+	}
+	// Returns how many items the array can hold before having to resize.
+	constexpr usize cap() const
+	{
+		return _cap;
+	}
+	// Returns the arena the array was allocated in.
+	constexpr Maybe<Arena&> arena() const
+	{
+		if (_src_arena == nullptr) {
+			return {};
+		}
+		return *_src_arena;
+	}
+
+	// Returns a view of a column, which is just a regular array. It becomes invalid after the
+	// array grows.
+	template<usize I>
+	constexpr Array<const Column<I>> column() const
+	{
+		_validate();
+		return {_column_ptr<I>(), _len};
+	}
+
+	// Returns a view of a column, which is just a regular array that can't grow. It becomes
+	// invalid after the SoaArray grows.
+	template<usize I>
+	constexpr Array<Column<I>> column()
+	{
+		_validate();
+		return {_column_ptr<I>(), _len};
+	}
+
+	// Returns a single field from an item.
+	template<usize I>
+	constexpr Column<I>& get(usize idx) const
+	{
+		_check_index(idx);
+		return _column_ptr<I>()[idx];
+	}
+
+	// Returns every field from an item, use it with structured bindings.
+	constexpr SoaItem<Fields...> operator[](usize idx) const
+	{
+		_check_index(idx);
+		return {_columns, idx};
+	}
+
+	// fucking iterator
+	class Iterator
+	{
+	public:
+		constexpr Iterator(void* const* columns, usize idx)
+			: _columns(columns)
+			, _idx(idx)
+		{
+		}
+		constexpr SoaItem<Fields...> operator*() const
+		{
+			return {_columns, _idx};
+		}
+		constexpr Iterator& operator++()
+		{
+			_idx++;
+			return *this;
+		}
+		constexpr bool operator!=(const Iterator& other) const
+		{
+			return _idx != other._idx;
+		}
+
+	private:
+		void* const* _columns;
+		usize _idx;
+	};
+
+	constexpr Iterator begin() const
+	{
+		return Iterator(_columns, 0);
+	}
+	constexpr Iterator end() const
+	{
+		return Iterator(_columns, _len);
+	}
+
+private:
+	constexpr void _check_index(usize idx) const
+	{
+		if constexpr (!BOUNDS_CHECK) {
+			return;
+		}
+
+		_validate();
+		if (idx >= _len) [[unlikely]] {
+			tr::panic(
+				"index out of range: soa[%zu] when the length is %zu", idx, _len
+			);
+		}
+	}
+
+	template<usize I>
+	void _init_column(usize from, usize to)
+	{
+		for (usize i = from; i < to; i++) {
+			new (&_column_ptr<I>()[i]) Column<I>{};
+		}
+	}
+};
+
 } // namespace tr
 
+// structured bindings for `tr::SoaItem`
+namespace std {
+
+template<typename... Fields>
+struct tuple_size<tr::SoaItem<Fields...>>
+	: std::integral_constant<usize, sizeof...(Fields) + 1>
+{
+};
+
+template<typename... Fields>
+struct tuple_element<0, tr::SoaItem<Fields...>>
+{
+	using type = usize;
+};
+
+template<usize I, typename... Fields>
+struct tuple_element<I, tr::SoaItem<Fields...>>
+{
+	using type = typename tr::_tr::NthType<I - 1, Fields...>::Type&;
+};
+
+} // namespace std
+
 #endif
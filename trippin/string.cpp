@@ -25,6 +25,7 @@
 
 #include "trippin/string.h"
 
+#include <bit>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
@@ -37,6 +38,19 @@
 #define UTF8PROC_STATIC // otherwise it shits itself on windows
 #include "trippin/thirdparty/utf8proc/utf8proc.c" // i love the preprocessor
 
+// searching compares a bunch of bytes at once if it can. there's no runtime detection so AVX2
+// is only used if you compile with it (e.g. -mavx2 or -march=native)
+#if defined(__AVX2__)
+	#define TR_STRING_AVX2
+	#include <immintrin.h>
+#elif defined(TR_ARCH_X86_64) || defined(__SSE2__)
+	#define TR_STRING_SSE2
+	#include <emmintrin.h>
+#elif defined(TR_ARCH_ARM64) || defined(__ARM_NEON)
+	#define TR_STRING_NEON
+	#include <arm_neon.h>
+#endif
+
 // FIXME theres probably 2050 different violations of strict aliasing
 // and 2050 different security vulnerabilities
 
@@ -64,6 +78,166 @@ usize tr::strlib::sprintf_len(const char* fmt, va_list arg)
 	return static_cast<usize>(size);
 }
 
+namespace tr {
+
+namespace _tr {
+#if defined(TR_STRING_AVX2) || defined(TR_STRING_SSE2) || defined(TR_STRING_NEON)
+	#define TR_STRING_SIMD
+
+	// a bunch of bytes that get compared all at once. the mask has a bit for every byte that
+	// matched, except on NEON where it's 4 bits per byte (see `tr::_tr::HashMapMask`)
+	struct ByteBlock
+	{
+	#if defined(TR_STRING_AVX2)
+		static constexpr usize LEN = 32;
+		static constexpr int SHIFT = 0;
+		__m256i bytes;
+
+		static ByteBlock load(const char* ptr)
+		{
+			return {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr))};
+		}
+
+		static ByteBlock splat(char c)
+		{
+			return {_mm256_set1_epi8(c)};
+		}
+
+		uint64 match(ByteBlock other) const
+		{
+			__m256i eq = _mm256_cmpeq_epi8(bytes, other.bytes);
+			return static_cast<uint64>(static_cast<uint32>(_mm256_movemask_epi8(eq)));
+		}
+	#elif defined(TR_STRING_SSE2)
+		static constexpr usize LEN = 16;
+		static constexpr int SHIFT = 0;
+		__m128i bytes;
+
+		static ByteBlock load(const char* ptr)
+		{
+			return {_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr))};
+		}
+
+		static ByteBlock splat(char c)
+		{
+			return {_mm_set1_epi8(c)};
+		}
+
+		uint64 match(ByteBlock other) const
+		{
+			__m128i eq = _mm_cmpeq_epi8(bytes, other.bytes);
+			return static_cast<uint64>(static_cast<uint32>(_mm_movemask_epi8(eq)));
+		}
+	#else
+		static constexpr usize LEN = 16;
+		static constexpr int SHIFT = 2;
+		uint8x16_t bytes;
+
+		static ByteBlock load(const char* ptr)
+		{
+			return {vld1q_u8(reinterpret_cast<const uint8*>(ptr))};
+		}
+
+		static ByteBlock splat(char c)
+		{
+			return {vdupq_n_u8(static_cast<uint8>(c))};
+		}
+
+		uint64 match(ByteBlock other) const
+		{
+			uint8x16_t eq = vceqq_u8(bytes, other.bytes);
+			uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+			uint64 bits = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+			return bits & 0x8888888888888888ull;
+		}
+	#endif
+	};
+
+	static usize first_match(uint64 mask)
+	{
+		return static_cast<usize>(std::countr_zero(mask)) >> ByteBlock::SHIFT;
+	}
+#endif
+
+	static bool is_ascii_space(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	// turns `start` and `end` from the find functions into an actual range, returns false if
+	// there's nothing to search
+	static bool find_range(usize len, usize start, usize& end)
+	{
+		if (end == 0) {
+			end = len;
+		}
+		end = tr::min(end, len);
+		return start < end;
+	}
+} // namespace _tr
+
+} // namespace tr
+
+tr::Maybe<usize> tr::strlib::find_char(const char* s, usize len, char c)
+{
+	usize i = 0;
+#ifdef TR_STRING_SIMD
+	_tr::ByteBlock needle = _tr::ByteBlock::splat(c);
+	for (; i + _tr::ByteBlock::LEN <= len; i += _tr::ByteBlock::LEN) {
+		uint64 mask = _tr::ByteBlock::load(s + i).match(needle);
+		if (mask != 0) {
+			return i + _tr::first_match(mask);
+		}
+	}
+#endif
+
+	// whatever's left
+	for (; i < len; i++) {
+		if (s[i] == c) {
+			return i;
+		}
+	}
+	return {};
+}
+
+tr::Maybe<usize>
+tr::strlib::find_str(const char* s, usize len, const char* needle, usize needle_len)
+{
+	if (needle_len == 0 || needle_len > len) {
+		return {};
+	}
+	if (needle_len == 1) {
+		return find_char(s, len, needle[0]);
+	}
+
+	usize last = needle_len - 1;
+	usize i = 0;
+#ifdef TR_STRING_SIMD
+	// every byte in the block is a possible start, and it's only worth checking if the first
+	// and last byte are right. with real text that throws away almost everything
+	_tr::ByteBlock first_byte = _tr::ByteBlock::splat(needle[0]);
+	_tr::ByteBlock last_byte = _tr::ByteBlock::splat(needle[last]);
+	for (; i + last + _tr::ByteBlock::LEN <= len; i += _tr::ByteBlock::LEN) {
+		uint64 mask = _tr::ByteBlock::load(s + i).match(first_byte) &
+			_tr::ByteBlock::load(s + i + last).match(last_byte);
+		for (; mask != 0; mask &= mask - 1) {
+			usize pos = i + _tr::first_match(mask);
+			if (memcmp(s + pos + 1, needle + 1, needle_len - 2) == 0) {
+				return pos;
+			}
+		}
+	}
+#endif
+
+	// whatever's left
+	for (; i + needle_len <= len; i++) {
+		if (s[i] == needle[0] && memcmp(s + i, needle, needle_len) == 0) {
+			return i;
+		}
+	}
+	return {};
+}
+
 usize tr::String::codepoint_len() const
 {
 	usize n = 0;
@@ -176,16 +350,19 @@ tr::Array<usize> tr::String::find(tr::Arena& arena, char c, usize start, usize e
 	if (len() == 0) {
 		return {};
 	}
-	if (end == 0) {
-		end = len();
-	}
-	end = tr::clamp(end, start, len());
 
 	Array<usize> indexes{arena};
-	for (usize i = start; i < end; i++) {
-		if (buf()[i] == c) {
-			indexes.add(i);
+	if (!_tr::find_range(len(), start, end)) {
+		return indexes;
+	}
+
+	for (usize i = start; i < end;) {
+		Maybe<usize> idx = strlib::find_char(buf() + i, end - i, c);
+		if (idx.is_invalid()) {
+			break;
 		}
+		indexes.add(i + idx.unwrap());
+		i += idx.unwrap() + 1;
 	}
 	return indexes;
 }
@@ -200,24 +377,126 @@ tr::Array<usize> tr::String::find(tr::Arena& arena, tr::String str, usize start,
 	if (str.len() == 0) {
 		return {};
 	}
-	if (end == 0) {
-		end = len();
-	}
-	end = tr::clamp(end, start, len()) + 1;
 
 	Array<usize> indexes{arena};
-	for (usize i = start; i < end; i++) {
-		if (i + str.len() > len()) {
-			continue;
-		}
+	if (!_tr::find_range(len(), start, end)) {
+		return indexes;
+	}
 
-		if (memcmp(&buf()[i], *str, str.len()) == 0) {
-			indexes.add(i);
+	for (usize i = start; i < end;) {
+		Maybe<usize> idx = strlib::find_str(buf() + i, end - i, *str, str.len());
+		if (idx.is_invalid()) {
+			break;
 		}
+		indexes.add(i + idx.unwrap());
+		i += idx.unwrap() + 1;
 	}
 	return indexes;
 }
 
+tr::Maybe<usize> tr::String::find_first(char c, usize start, usize end) const
+{
+	_validate();
+	if (!_tr::find_range(len(), start, end)) {
+		return {};
+	}
+
+	Maybe<usize> idx = strlib::find_char(buf() + start, end - start, c);
+	if (idx.is_invalid()) {
+		return {};
+	}
+	return start + idx.unwrap();
+}
+
+tr::Maybe<usize> tr::String::find_first(tr::String str, usize start, usize end) const
+{
+	_validate();
+	str._validate();
+	if (!_tr::find_range(len(), start, end)) {
+		return {};
+	}
+
+	Maybe<usize> idx = strlib::find_str(buf() + start, end - start, *str, str.len());
+	if (idx.is_invalid()) {
+		return {};
+	}
+	return start + idx.unwrap();
+}
+
+tr::StrView tr::StrView::trim_start() const
+{
+	usize start = 0;
+	while (start < _len && _tr::is_ascii_space(_ptr[start])) {
+		start++;
+	}
+	return slice(start);
+}
+
+tr::StrView tr::StrView::trim_end() const
+{
+	usize end = _len;
+	while (end > 0 && _tr::is_ascii_space(_ptr[end - 1])) {
+		end--;
+	}
+	return slice(0, end);
+}
+
+tr::Maybe<usize> tr::StrView::find_first(char c, usize start) const
+{
+	if (start >= _len) {
+		return {};
+	}
+
+	Maybe<usize> idx = strlib::find_char(_ptr + start, _len - start, c);
+	if (idx.is_invalid()) {
+		return {};
+	}
+	return start + idx.unwrap();
+}
+
+tr::Maybe<usize> tr::StrView::find_first(tr::StrView str, usize start) const
+{
+	if (start >= _len) {
+		return {};
+	}
+
+	Maybe<usize> idx = strlib::find_str(_ptr + start, _len - start, *str, str.len());
+	if (idx.is_invalid()) {
+		return {};
+	}
+	return start + idx.unwrap();
+}
+
+bool tr::StrView::operator==(tr::StrView other) const
+{
+	if (_len != other._len) {
+		return false;
+	}
+	// memcmp with a null pointer is technically undefined even if the length is 0
+	return _len == 0 || memcmp(_ptr, *other, _len) == 0;
+}
+
+void tr::StrView::SplitIterator::_find_piece_len()
+{
+	usize left = static_cast<usize>(_end - _piece);
+	Maybe<usize> delimiter = strlib::find_char(_piece, left, _delimiter);
+	_piece_len = delimiter.is_valid() ? delimiter.unwrap() : left;
+}
+
+tr::StrView::SplitIterator& tr::StrView::SplitIterator::operator++()
+{
+	// no delimiter means that was the last piece
+	const char* piece_end = _piece + _piece_len;
+	if (piece_end == _end) {
+		_piece = nullptr;
+		return *this;
+	}
+
+	_piece = piece_end + 1;
+	_find_piece_len();
+	return *this;
+}
+
 tr::String tr::String::concat(tr::Arena& arena, tr::String other) const
 {
 	_validate();
@@ -369,41 +648,22 @@ tr::String tr::String::replace(tr::Arena& arena, char from, char to) const
 
 tr::Array<tr::String> tr::String::split(tr::Arena& arena, char delimiter) const
 {
-	// FIXME this might be ass
 	_validate();
 	if (len() == 0) {
 		return {};
 	}
 
-	Array<String> strs{arena};
-	usize last_str = 0;
-	usize tmplen = len();
-
-	for (usize i = 0; i < tmplen; i++) {
-		if (buf()[i] == delimiter || i == tmplen - 1) {
-			// small hack so that i don't have to change this code any more than what is
-			// required to make it work
-			if (i == tmplen - 1) {
-				tmplen++;
-				i++;
-			}
-
-			// substr() just breaks for whatever reason
-			char* newstr = arena.alloc<char*>(i - last_str + 1);
-			memcpy(newstr, &buf()[last_str], i - last_str);
-			tr::strlib::explicit_memset(newstr + i - last_str, 1, 0);
-			strs.add(newstr);
-			last_str = i + 1;
-
-			if (i == tmplen - 1) {
-				return strs;
-			}
-		}
-	}
+	// copying the whole thing once and replacing the delimiters with null terminators is
+	// much better than allocating every piece
+	char* copy = arena.alloc<char*>(len() + 1);
+	memcpy(copy, buf(), len());
+	copy[len()] = '\0';
 
-	// if nothing was found
-	if (strs.len() == 0) {
-		strs.add(duplicate(arena));
+	Array<String> strs{arena};
+	for (StrView piece : StrView{*this}.split_iter(delimiter)) {
+		usize offset = static_cast<usize>(piece.buf() - buf());
+		copy[offset + piece.len()] = '\0';
+		strs.add(String{copy + offset, piece.len()});
 	}
 	return strs;
 }
@@ -480,7 +740,9 @@ void tr::StringBuilder::appendf(const char* fmt, ...)
 	va_list arg;
 	va_start(arg, fmt);
 
-	ScratchArena scratch{};
+	// the string builder itself could be in a scratch arena
+	Maybe<Arena&> arena = _array.arena();
+	ScratchArena scratch = arena.is_valid() ? ScratchArena{arena.unwrap()} : ScratchArena{};
 	append(tr::fmt_args(scratch, fmt, arg));
 	scratch.free();
 
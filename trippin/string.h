@@ -71,6 +71,13 @@ namespace strlib {
 	void utf8_to_uppercase(const char* s, usize len, char* out);
 	// converts an unicode string to lowercase.
 	void utf8_to_lowercase(const char* s, usize len, char* out);
+
+	// like memchr, but 16 (or 32 with AVX2) bytes at a time, returns null if it's not there
+	Maybe<usize> find_char(const char* s, usize len, char c);
+
+	// like strstr/memmem. it looks for the first and last byte of the needle with SIMD, and
+	// only compares the whole needle where both of them match. returns null if it's not there
+	Maybe<usize> find_str(const char* s, usize len, const char* needle, usize needle_len);
 }
 
 // more utf-8 stuff
@@ -79,8 +86,223 @@ namespace strlib {
 // value by the current Unicode standard.
 bool is_unicode_codepoint_valid(char32 c);
 
+class String;
 class StringBuilder;
 
+// A slice of a string that doesn't own anything. Unlike `tr::String` it's NOT null-terminated,
+// which means slicing, splitting, and trimming it doesn't have to allocate or copy anything, it
+// just points to a different part of the same buffer. Use `to_string()` when you need a
+// `tr::String` (e.g. for C libraries that want the null terminator).
+class StrView
+{
+	const char* _ptr;
+	usize _len;
+
+public:
+	using Type = char;
+
+	constexpr StrView(const char* str, usize len)
+		: _ptr(str)
+		, _len(len)
+	{
+	}
+
+	constexpr StrView(const char* str)
+		: StrView(str, tr::strlib::constexpr_strlen(str))
+	{
+	}
+
+	constexpr StrView()
+		: _ptr("")
+		, _len(0)
+	{
+	}
+
+	// In bytes, not codepoints
+	constexpr usize len() const
+	{
+		return _len;
+	}
+
+	// Remember this isn't null-terminated
+	constexpr const char* buf() const
+	{
+		return _ptr;
+	}
+
+	// Remember this isn't null-terminated
+	constexpr const char* operator*() const
+	{
+		return _ptr;
+	}
+
+	// Similar to `operator[]`, but when getting an index out of bounds, instead of panicking,
+	// it returns null. Note this works with bytes, NOT codepoints.
+	constexpr Maybe<char> try_get(usize idx) const
+	{
+		if (idx >= _len) {
+			return {};
+		}
+		return _ptr[idx];
+	}
+
+	// Note this works with bytes, NOT codepoints.
+	constexpr char operator[](usize idx) const
+	{
+		if (idx >= _len) [[unlikely]] {
+			tr::panic(
+				"index out of range: view[%zu] when the length is %zu", idx, _len
+			);
+		}
+		return _ptr[idx];
+	}
+
+	// Returns the part between `start` and `end`. Unlike `String::substr()`, `end` isn't
+	// included, and nothing is copied. Both get clamped to the length.
+	constexpr StrView slice(usize start, usize end) const
+	{
+		end = end > _len ? _len : end;
+		start = start > end ? end : start;
+		return {_ptr + start, end - start};
+	}
+
+	// Returns everything after `start` (included)
+	constexpr StrView slice(usize start) const
+	{
+		return slice(start, _len);
+	}
+
+	// Removes whitespace from the start and end (only ASCII whitespace)
+	StrView trim() const
+	{
+		return trim_start().trim_end();
+	}
+
+	// Removes whitespace from the start (only ASCII whitespace)
+	StrView trim_start() const;
+
+	// Removes whitespace from the end (only ASCII whitespace)
+	StrView trim_end() const;
+
+	// Returns the index of the first `c` starting from `start`, or null if there isn't one.
+	// Slice it first if you want to search a smaller part.
+	Maybe<usize> find_first(char c, usize start = 0) const;
+
+	// Returns the index of the first `str` starting from `start`, or null if there isn't one.
+	// Slice it first if you want to search a smaller part.
+	Maybe<usize> find_first(StrView str, usize start = 0) const;
+
+	// Returns the index of the next `c` after `prev`, which is usually whatever `find_first()`
+	// or `find_next()` returned before.
+	Maybe<usize> find_next(char c, usize prev) const
+	{
+		return find_first(c, prev + 1);
+	}
+
+	// Returns the index of the next `str` after `prev`, which is usually whatever
+	// `find_first()` or `find_next()` returned before. Matches can overlap.
+	Maybe<usize> find_next(StrView str, usize prev) const
+	{
+		return find_first(str, prev + 1);
+	}
+
+	// If true, the view starts with that other crap.
+	bool starts_with(StrView str) const
+	{
+		return str.len() <= _len && slice(0, str.len()) == str;
+	}
+
+	// If true, the view ends with that other crap.
+	bool ends_with(StrView str) const
+	{
+		return str.len() <= _len && slice(_len - str.len()) == str;
+	}
+
+	bool operator==(StrView other) const;
+
+	bool operator!=(StrView other) const
+	{
+		return !(*this == other);
+	}
+
+	// Copies the view to an arena, so it's null-terminated.
+	[[nodiscard]]
+	String to_string(Arena& arena) const;
+
+	// fucking iterator
+	class SplitIterator
+	{
+	public:
+		SplitIterator(const char* piece, const char* end, char delimiter)
+			: _piece(piece)
+			, _end(end)
+			, _delimiter(delimiter)
+		{
+			if (_piece != nullptr) {
+				_find_piece_len();
+			}
+		}
+
+		StrView operator*() const
+		{
+			return {_piece, _piece_len};
+		}
+
+		SplitIterator& operator++();
+
+		bool operator!=(const SplitIterator& other) const
+		{
+			return _piece != other._piece;
+		}
+
+	private:
+		// null once there's nothing left
+		const char* _piece;
+		usize _piece_len = 0;
+		const char* _end;
+		char _delimiter;
+
+		void _find_piece_len();
+	};
+
+	// what `split_iter()` returns, it's just something you can put in a for loop
+	class Split
+	{
+	public:
+		Split(const char* ptr, usize len, char delimiter)
+			: _ptr(ptr)
+			, _len(len)
+			, _delimiter(delimiter)
+		{
+		}
+
+		SplitIterator begin() const
+		{
+			return {_ptr, _ptr + _len, _delimiter};
+		}
+
+		SplitIterator end() const
+		{
+			return {nullptr, nullptr, _delimiter};
+		}
+
+	private:
+		const char* _ptr;
+		usize _len;
+		char _delimiter;
+	};
+
+	// Splits the view into several pieces using the specified delimiter, as you go, without
+	// allocating anything. The pieces are views into the same buffer. Empty pieces are kept,
+	// e.g. `"a,,b,"` is `"a"`, `""`, `"b"`, and `""`. Use it in a for loop:
+	//
+	//     for (tr::StrView field : line.split_iter(',')) { ... }
+	Split split_iter(char delimiter) const
+	{
+		return {_ptr, _len, delimiter};
+	}
+};
+
 // A view into immutable UTF-8 strings. Strings are just a pointer + length, with the underlying
 // data being const. If you want to modify it, copy the data, or use `StringBuilder`. The 'default'
 // string type, equivalent to `std::string_view`. Always null-terminated, so it can be safely used
@@ -143,8 +365,10 @@ public:
 			}
 		}
 
-		char* newptr = arena.alloc<char*>(len * sizeof(char));
+		// it may or may not already have the null terminator so just add one anyway
+		char* newptr = arena.alloc<char*>((len + 1) * sizeof(char));
 		memcpy(newptr, str, len * sizeof(char));
+		newptr[len] = '\0';
 		_ptr = newptr;
 	}
 
@@ -204,6 +428,12 @@ public:
 		return _ptr;
 	}
 
+	// Strings are also views, just null-terminated ones
+	constexpr operator StrView() const
+	{
+		return {buf(), len()};
+	}
+
 	// Similar to `operator[]`, but when getting an index out of bounds, instead
 	// of panicking, it returns null, which is probably useful sometimes. Note this works with
 	// bytes, NOT codepoints. Use `try_get_codepoint()` if you need codepoints.
@@ -317,9 +547,36 @@ public:
 	// TODO find_codepoint? idk how useful that'd be
 
 	// Returns an array with all of the indexes containing the substring (the index is where it
-	// starts). Note that the indexes and `start` and `end` are NOT in codepoints.
+	// starts). The whole substring has to be before `end`. Note that the indexes and `start`
+	// and `end` are NOT in codepoints.
 	Array<usize> find(Arena& arena, String str, usize start = 0, usize end = 0) const;
 
+	// Returns the index of the first `c` between `start` and `end` (not included), or null if
+	// there isn't one. Unlike `find()` it doesn't allocate anything. Note that the index and
+	// `start` and `end` are NOT in codepoints.
+	Maybe<usize> find_first(char c, usize start = 0, usize end = 0) const;
+
+	// Returns the index of the first `str` between `start` and `end` (not included), or null
+	// if there isn't one. Unlike `find()` it doesn't allocate anything. Note that the index and
+	// `start` and `end` are NOT in codepoints.
+	Maybe<usize> find_first(String str, usize start = 0, usize end = 0) const;
+
+	// Returns the index of the next `c` after `prev`, which is usually whatever `find_first()`
+	// or `find_next()` returned before, so you can go through every match without
+	// allocating.
+	Maybe<usize> find_next(char c, usize prev, usize end = 0) const
+	{
+		return find_first(c, prev + 1, end);
+	}
+
+	// Returns the index of the next `str` after `prev`, which is usually whatever
+	// `find_first()` or `find_next()` returned before, so you can go through every match
+	// without allocating. Matches can overlap, same as `find()`.
+	Maybe<usize> find_next(String str, usize prev, usize end = 0) const
+	{
+		return find_first(str, prev + 1, end);
+	}
+
 	// It concatenates 2 strings lmao. Usually you should use `tr::fmt` or `tr::StringBuilder`.
 	[[nodiscard]]
 	String concat(Arena& arena, String other) const;
@@ -358,7 +615,9 @@ public:
 
 	// TODO replace_codepoint?
 
-	// Splits the string into several substrings using the specified delimiter.
+	// Splits the string into several substrings using the specified delimiter. The string is
+	// only copied once, and every substring points to that copy. If you don't need them to be
+	// null-terminated, `tr::StrView::split_iter()` doesn't allocate at all.
 	[[nodiscard]]
 	Array<String> split(Arena& arena, char delimiter) const;
 
@@ -558,6 +817,11 @@ inline String::String(Arena& arena, StringBuilder sb)
 {
 }
 
+inline String StrView::to_string(Arena& arena) const
+{
+	return {arena, _ptr, _len};
+}
+
 String fmt_args(Arena& arena, const char* fmt, va_list arg);
 
 // It's just `sprintf` for `tr::String` lmao.
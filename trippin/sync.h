@@ -0,0 +1,620 @@
+/*
+ * libtrippin: Most massive library of all time
+ * https://github.com/hellory4n/libtrippin
+ *
+ * trippin/sync.h
+ * Lock-free queues and other crap for sharing things between threads
+ *
+ * Copyright (C) 2025 by hellory4n <hellory4n@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this
+ * software for any purpose with or without fee is hereby
+ * granted.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS
+ * ALL WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+ * INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+ * WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE
+ * USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef _TRIPPIN_SYNC_H
+#define _TRIPPIN_SYNC_H
+
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <new> // IWYU pragma: keep
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+#include "trippin/common.h"
+#include "trippin/memory.h"
+#include "trippin/util.h"
+
+namespace tr {
+
+namespace _tr {
+	// queues need a power of 2 so indexes can wrap around with a mask
+	constexpr usize queue_capacity(usize capacity)
+	{
+		usize cap = 2;
+		while (cap < capacity) {
+			cap <<= 1;
+		}
+		return cap;
+	}
+} // namespace _tr
+
+// A bounded queue where exactly 1 thread pushes and exactly 1 thread pops (they can be different
+// threads, that's the point). It doesn't use any locks, and the producer and the consumer don't
+// share cache lines unless they have to. The capacity is rounded up to a power of 2.
+//
+// Unlike most libtrippin types this can't be copied, since it has atomics, so pass it by
+// reference.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class SpscQueue
+{
+	T* _buf = nullptr;
+	usize _cap = 0;
+
+	// only the consumer writes the head, so it caches the tail to not touch the producer's
+	// cache line all the time
+	alignas(CACHE_LINE_SIZE) std::atomic<usize> _head = 0;
+	usize _cached_tail = 0;
+
+	// same but the other way around
+	alignas(CACHE_LINE_SIZE) std::atomic<usize> _tail = 0;
+	usize _cached_head = 0;
+
+	constexpr void _validate() const
+	{
+		if (_buf == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::SpscQueue<T>!");
+		}
+	}
+
+	T* _slot(usize idx) const
+	{
+		return &_buf[idx & (_cap - 1)];
+	}
+
+	// how much the producer can push, only call from the producer
+	usize _free_space(usize tail)
+	{
+		if (tail - _cached_head == _cap) {
+			_cached_head = _head.load(std::memory_order_acquire);
+		}
+		return _cap - (tail - _cached_head);
+	}
+
+	// how much the consumer can pop, only call from the consumer
+	usize _available(usize head)
+	{
+		if (head == _cached_tail) {
+			_cached_tail = _tail.load(std::memory_order_acquire);
+		}
+		return _cached_tail - head;
+	}
+
+public:
+	using Type = T;
+
+	SpscQueue() {}
+
+	// Initializes a queue at an arena. The capacity is rounded up to a power of 2.
+	SpscQueue(Arena& arena, usize capacity)
+		: _cap(_tr::queue_capacity(capacity))
+	{
+		_buf = static_cast<T*>(arena.alloc(_cap * sizeof(T), alignof(T)));
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Adds an item to the queue. Returns false if it's full. Only call this from the producer
+	// thread.
+	[[nodiscard]]
+	bool push(T val)
+	{
+		_validate();
+		usize tail = _tail.load(std::memory_order_relaxed);
+		if (_free_space(tail) == 0) {
+			return false;
+		}
+
+		new (_slot(tail)) T(std::move(val));
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Removes the oldest item and returns it, or null if it's empty. Only call this from the
+	// consumer thread.
+	Maybe<T> pop()
+	{
+		_validate();
+		usize head = _head.load(std::memory_order_relaxed);
+		if (_available(head) == 0) {
+			return {};
+		}
+
+		T* slot = _slot(head);
+		T val = std::move(*slot);
+		slot->~T();
+		_head.store(head + 1, std::memory_order_release);
+		return val;
+	}
+
+	// Adds as many items as it can, and returns how many it added. It's at most 2 copies and
+	// 1 atomic store. Only call this from the producer thread.
+	usize push_n(Array<const T> items)
+	{
+		_validate();
+		usize tail = _tail.load(std::memory_order_relaxed);
+		usize n = tr::min(items.len(), _free_space(tail));
+		if (n == 0) {
+			return 0;
+		}
+
+		usize first = tr::min(n, _cap - (tail & (_cap - 1)));
+		tr::_copy_construct_items<T>(_slot(tail), items.buf(), first);
+		tr::_copy_construct_items<T>(_buf, items.buf() + first, n - first);
+		_tail.store(tail + n, std::memory_order_release);
+		return n;
+	}
+
+	// Removes as many items as it can, puts them in `out`, and returns how many it removed.
+	// It's at most 2 copies and 1 atomic store. Only call this from the consumer thread. The
+	// items in `out` are assigned over, so they have to be valid already.
+	usize pop_n(Array<T> out)
+	{
+		_validate();
+		usize head = _head.load(std::memory_order_relaxed);
+		usize n = tr::min(out.len(), _available(head));
+		if (n == 0) {
+			return 0;
+		}
+
+		usize first = tr::min(n, _cap - (head & (_cap - 1)));
+		tr::_move_assign_items<T>(out.buf(), _slot(head), first);
+		tr::_move_assign_items<T>(out.buf() + first, _buf, n - first);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			for (usize i = 0; i < n; i++) {
+				_slot(head + i)->~T();
+			}
+		}
+		_head.store(head + n, std::memory_order_release);
+		return n;
+	}
+
+	// Returns how many items are in the queue. If other threads are using it, it may have
+	// changed by the time this returns.
+	usize len() const
+	{
+		usize head = _head.load(std::memory_order_acquire);
+		return _tail.load(std::memory_order_acquire) - head;
+	}
+
+	// Returns how many items the queue can hold.
+	constexpr usize cap() const
+	{
+		return _cap;
+	}
+};
+
+// A bounded queue where any amount of threads can push and pop at the same time. It doesn't use
+// any locks, instead every slot has a sequence number that says whose turn it is (this is Dmitry
+// Vyukov's bounded MPMC queue, if you want to look it up). The capacity is rounded up to a power
+// of 2.
+//
+// Unlike most libtrippin types this can't be copied, since it has atomics, so pass it by
+// reference.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class MpmcQueue
+{
+	struct Cell
+	{
+		// if it's the same as the position, it's empty and waiting for a producer. if it's
+		// the position + 1, it has an item and is waiting for a consumer
+		std::atomic<usize> sequence;
+		alignas(T) byte storage[sizeof(T)];
+	};
+
+	Cell* _cells = nullptr;
+	usize _cap = 0;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<usize> _enqueue_pos = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<usize> _dequeue_pos = 0;
+
+	constexpr void _validate() const
+	{
+		if (_cells == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::MpmcQueue<T>!");
+		}
+	}
+
+	Cell* _cell(usize pos) const
+	{
+		return &_cells[pos & (_cap - 1)];
+	}
+
+	// claims up to `max` positions starting at `pos`, where each cell's sequence has to be the
+	// position + `offset`. returns how many it claimed, and `pos` is where they start
+	usize _claim(std::atomic<usize>& counter, usize& pos, usize max, usize offset)
+	{
+		pos = counter.load(std::memory_order_relaxed);
+		if (max == 0) {
+			return 0;
+		}
+
+		while (true) {
+			// the first cell decides if it's full/empty or someone else got there first
+			usize sequence = _cell(pos)->sequence.load(std::memory_order_acquire);
+			isize diff = static_cast<isize>(sequence - (pos + offset));
+			if (diff < 0) {
+				return 0;
+			}
+			if (diff > 0) {
+				pos = counter.load(std::memory_order_relaxed);
+				continue;
+			}
+
+			// nobody else can touch these cells until we move the counter past them, so
+			// checking them before claiming them is fine
+			usize n = 1;
+			while (n < max) {
+				sequence = _cell(pos + n)->sequence.load(std::memory_order_acquire);
+				if (sequence != pos + n + offset) {
+					break;
+				}
+				n++;
+			}
+
+			bool claimed = counter.compare_exchange_weak(
+				pos, pos + n, std::memory_order_relaxed, std::memory_order_relaxed
+			);
+			if (claimed) {
+				return n;
+			}
+		}
+	}
+
+public:
+	using Type = T;
+
+	MpmcQueue() {}
+
+	// Initializes a queue at an arena. The capacity is rounded up to a power of 2.
+	MpmcQueue(Arena& arena, usize capacity)
+		: _cap(_tr::queue_capacity(capacity))
+	{
+		_cells = static_cast<Cell*>(arena.alloc(_cap * sizeof(Cell), alignof(Cell)));
+		for (usize i = 0; i < _cap; i++) {
+			new (&_cells[i].sequence) std::atomic<usize>(i);
+		}
+	}
+
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	// Adds an item to the queue. Returns false if it's full.
+	[[nodiscard]]
+	bool push(T val)
+	{
+		_validate();
+		usize pos = 0;
+		if (_claim(_enqueue_pos, pos, 1, 0) == 0) {
+			return false;
+		}
+
+		Cell* cell = _cell(pos);
+		new (cell->storage) T(std::move(val));
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Removes the oldest item and returns it, or null if it's empty.
+	Maybe<T> pop()
+	{
+		_validate();
+		usize pos = 0;
+		if (_claim(_dequeue_pos, pos, 1, 1) == 0) {
+			return {};
+		}
+
+		Cell* cell = _cell(pos);
+		T* item = reinterpret_cast<T*>(cell->storage);
+		T val = std::move(*item);
+		item->~T();
+		cell->sequence.store(pos + _cap, std::memory_order_release);
+		return val;
+	}
+
+	// Adds as many items as it can (that are next to each other), and returns how many it
+	// added. Claiming the slots is a single atomic operation, instead of 1 per item.
+	usize push_n(Array<const T> items)
+	{
+		_validate();
+		usize pos = 0;
+		usize n = _claim(_enqueue_pos, pos, items.len(), 0);
+		for (usize i = 0; i < n; i++) {
+			Cell* cell = _cell(pos + i);
+			new (cell->storage) T(items[i]);
+			cell->sequence.store(pos + i + 1, std::memory_order_release);
+		}
+		return n;
+	}
+
+	// Removes as many items as it can (that are next to each other), puts them in `out`, and
+	// returns how many it removed. Claiming the slots is a single atomic operation, instead of
+	// 1 per item. The items in `out` are assigned over, so they have to be valid already.
+	usize pop_n(Array<T> out)
+	{
+		_validate();
+		usize pos = 0;
+		usize n = _claim(_dequeue_pos, pos, out.len(), 1);
+		for (usize i = 0; i < n; i++) {
+			Cell* cell = _cell(pos + i);
+			T* item = reinterpret_cast<T*>(cell->storage);
+			out.buf()[i] = std::move(*item);
+			item->~T();
+			cell->sequence.store(pos + i + _cap, std::memory_order_release);
+		}
+		return n;
+	}
+
+	// Returns roughly how many items are in the queue. If other threads are using it, it
+	// probably changed by the time this returns.
+	usize len() const
+	{
+		usize dequeue = _dequeue_pos.load(std::memory_order_acquire);
+		usize enqueue = _enqueue_pos.load(std::memory_order_acquire);
+		return enqueue > dequeue ? enqueue - dequeue : 0;
+	}
+
+	// Returns how many items the queue can hold.
+	constexpr usize cap() const
+	{
+		return _cap;
+	}
+};
+
+// A hashmap that any amount of threads can use at the same time. It's split into a bunch of
+// shards (a power of 2), each one is a regular swiss table with its own lock. The key's hash
+// decides the shard. Since other threads could change it at any time, you get copies of values,
+// not references.
+//
+// Reads aren't lock-free, they take the shard's lock in shared mode. Readers never wait for each
+// other, only for someone writing to the same shard, but every lookup is still an atomic
+// operation on that lock's cache line. Skipping the lock (with a seqlock or similar) would mean
+// comparing keys and copying values that another thread may be halfway through writing, which
+// only works for trivially copyable types, and even then a key like `tr::String` points to
+// memory that isn't protected. For read-mostly tables (like the error messages) the lock is
+// almost never held exclusively, so it's cheap enough. Use more shards if it isn't.
+//
+// If more than 1 thread can add keys, the arena has to be a `tr::ConcurrentArena` (or something
+// else that's thread safe). Unlike most libtrippin types this can't be copied, since it has
+// locks, so pass it by reference.
+template<typename K, typename V, usize Shards = 16>
+requires(!std::is_reference_v<K> && !std::is_reference_v<V> && (Shards & (Shards - 1)) == 0)
+class ConcurrentHashMap
+{
+	struct Slot
+	{
+		K key;
+		V value;
+	};
+
+	// a shard per cache line (at least) so locking one doesn't slow down the others
+	struct alignas(CACHE_LINE_SIZE) Shard
+	{
+		mutable std::shared_mutex lock;
+		_tr::HashTable<K, Slot> table;
+	};
+
+	Shard* _shards = nullptr;
+	uint64 (*_hash_func)(const K& key) = nullptr;
+
+	constexpr void _validate() const
+	{
+		if (_shards == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::ConcurrentHashMap<K, V>!");
+		}
+	}
+
+	// the top bits pick the shard, since the swiss tables use the bottom bits
+	Shard& _shard(uint64 hash) const
+	{
+		constexpr int SHARD_BITS = std::countr_zero(Shards);
+		if constexpr (SHARD_BITS == 0) {
+			return _shards[0];
+		}
+		else {
+			return _shards[hash >> (64 - SHARD_BITS)];
+		}
+	}
+
+public:
+	using KeyType = K;
+	using ValueType = V;
+
+	ConcurrentHashMap() {}
+
+	// Initializes a hashmap at an arena. The initial capacity in the settings is split between
+	// the shards.
+	explicit ConcurrentHashMap(Arena& arena, HashMapSettings<K> settings)
+		: _hash_func(settings.hash_func)
+	{
+		settings.initial_capacity /= Shards;
+		_shards = static_cast<Shard*>(arena.alloc(Shards * sizeof(Shard), alignof(Shard)));
+		for (usize i = 0; i < Shards; i++) {
+			new (&_shards[i]) Shard{.lock = {}, .table = {arena, settings}};
+		}
+	}
+
+	explicit ConcurrentHashMap(Arena& arena)
+		: ConcurrentHashMap(arena, _tr::HashTable<K, Slot>::DEFAULT_SETTINGS)
+	{
+	}
+
+	ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+	ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+	// Returns a copy of the value for that key, or null if it's not there.
+	Maybe<V> get(const K& key) const
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::shared_lock<std::shared_mutex> lock{shard.lock};
+
+		isize idx = shard.table.find(key, hash);
+		if (idx == -1) {
+			return {};
+		}
+		return shard.table.slot(static_cast<usize>(idx)).value;
+	}
+
+	// If true, the hashmap has that key. Another thread could remove it right after this
+	// returns though, so `get()` is usually what you want.
+	bool contains(const K& key) const
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::shared_lock<std::shared_mutex> lock{shard.lock};
+		return shard.table.find(key, hash) != -1;
+	}
+
+	// Adds the key if it's not there, or replaces its value if it is. Returns true if the key
+	// is new.
+	bool set(K key, V value)
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::unique_lock<std::shared_mutex> lock{shard.lock};
+
+		auto [idx, found] = shard.table.find_or_insert(key, hash);
+		if (found) {
+			shard.table.slot(idx).value = std::move(value);
+		}
+		else {
+			new (&shard.table.slot(idx).value) V(std::move(value));
+		}
+		return !found;
+	}
+
+	// Adds the key only if it's not there already. Returns true if it was added.
+	bool insert(K key, V value)
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::unique_lock<std::shared_mutex> lock{shard.lock};
+
+		auto [idx, found] = shard.table.find_or_insert(key, hash);
+		if (!found) {
+			new (&shard.table.slot(idx).value) V(std::move(value));
+		}
+		return !found;
+	}
+
+	// Returns a copy of the value for that key, and if it's not there, it adds whatever `func`
+	// returns first. `func` runs with the shard locked, so don't use the hashmap from there.
+	template<typename Func>
+	V get_or_insert_with(K key, Func func)
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+
+		// most of the time it's already there, so try with the shared lock first
+		{
+			std::shared_lock<std::shared_mutex> lock{shard.lock};
+			isize idx = shard.table.find(key, hash);
+			if (idx != -1) {
+				return shard.table.slot(static_cast<usize>(idx)).value;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock{shard.lock};
+		auto [idx, found] = shard.table.find_or_insert(key, hash);
+		if (!found) {
+			new (&shard.table.slot(idx).value) V(func());
+		}
+		return shard.table.slot(idx).value;
+	}
+
+	// Calls `func` with a reference to the value for that key, while nobody else can touch
+	// it. Returns false if the key isn't there. Don't use the hashmap from `func`.
+	template<typename Func>
+	bool update(const K& key, Func func)
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::unique_lock<std::shared_mutex> lock{shard.lock};
+
+		isize idx = shard.table.find(key, hash);
+		if (idx == -1) {
+			return false;
+		}
+		func(shard.table.slot(static_cast<usize>(idx)).value);
+		return true;
+	}
+
+	// Removes the key from the hashmap. Returns true if the key is was found, returns false
+	// otherwise.
+	bool remove(const K& key)
+	{
+		_validate();
+		uint64 hash = _hash_func(key);
+		Shard& shard = _shard(hash);
+		std::unique_lock<std::shared_mutex> lock{shard.lock};
+		return shard.table.remove(key, hash);
+	}
+
+	// Calls `func(key, value)` for every item, one shard at a time. Other threads can change
+	// shards that haven't been reached yet (or were already done), so it's not a snapshot.
+	// Don't use the hashmap from `func`.
+	template<typename Func>
+	void for_each(Func func) const
+	{
+		_validate();
+		for (usize i = 0; i < Shards; i++) {
+			std::shared_lock<std::shared_mutex> lock{_shards[i].lock};
+			const _tr::HashTable<K, Slot>& table = _shards[i].table;
+			for (usize j = table.next_full(0); j < table.slot_count();) {
+				const Slot& slot = table.slot(j);
+				func(slot.key, slot.value);
+				j = table.next_full(j + 1);
+			}
+		}
+	}
+
+	// Returns how many items the hashmap has. If other threads are using it, it may have
+	// changed by the time this returns.
+	usize len() const
+	{
+		_validate();
+		usize len = 0;
+		for (usize i = 0; i < Shards; i++) {
+			std::shared_lock<std::shared_mutex> lock{_shards[i].lock};
+			len += _shards[i].table.len();
+		}
+		return len;
+	}
+};
+
+} // namespace tr
+
+#endif
@@ -31,13 +31,90 @@
 	#include <ctime>
 #endif
 
+#include <cstring>
+
 #include "trippin/common.h"
 
 constexpr uint64 FNV_OFFSET_BASIS = 0xcbf29ce484222325;
 // IM IN MY PRIME™ AND THIS AINT EVEN FINAL FORM
 constexpr uint64 FNV_PRIME = 0x100000001b3;
 
-uint64 tr::hash(const uint8* bytes, usize len)
+// memcpy so unaligned reads are fine, compilers turn it into a single load
+static inline uint64 wyr8(const uint8* p)
+{
+	uint64 val;
+	std::memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static inline uint64 wyr4(const uint8* p)
+{
+	uint32 val;
+	std::memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+// 1 to 3 bytes, some of them may be read twice
+static inline uint64 wyr3(const uint8* p, usize len)
+{
+	return (uint64{p[0]} << 16) | (uint64{p[len >> 1]} << 8) | p[len - 1];
+}
+
+// this is wyhash final version 4 (https://github.com/wangyi-fudan/wyhash), which is public domain
+uint64 tr::hash(const uint8* bytes, usize len, uint64 seed)
+{
+	using tr::_tr::wymix;
+	using tr::_tr::wymum;
+	const uint64* secret = tr::_tr::WYHASH_SECRET;
+
+	const uint8* p = bytes;
+	seed ^= wymix(seed ^ secret[0], secret[1]);
+	uint64 a = 0;
+	uint64 b = 0;
+
+	if (len <= 16) [[likely]] {
+		// short keys read overlapping chunks instead of looping
+		if (len >= 4) {
+			usize offset = (len >> 3) << 2;
+			a = (wyr4(p) << 32) | wyr4(p + offset);
+			b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - offset);
+		}
+		else if (len > 0) {
+			a = wyr3(p, len);
+		}
+	}
+	else {
+		usize i = len;
+		// 3 independent lanes so the CPU can do the multiplications at the same time
+		if (i >= 48) {
+			uint64 see1 = seed;
+			uint64 see2 = seed;
+			do {
+				seed = wymix(wyr8(p) ^ secret[1], wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ secret[2], wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ secret[3], wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i >= 48);
+			seed ^= see1 ^ see2;
+		}
+		while (i > 16) {
+			seed = wymix(wyr8(p) ^ secret[1], wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+		// the last 16 bytes, which may overlap with what was already hashed
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+
+	a ^= secret[1];
+	b ^= seed;
+	wymum(a, b);
+	return wymix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+
+uint64 tr::hash_fnv1a(const uint8* bytes, usize len)
 {
 	uint64 hash = FNV_OFFSET_BASIS;
 
@@ -26,24 +26,111 @@
 #ifndef _TRIPPIN_UTIL_H
 #define _TRIPPIN_UTIL_H
 
+#include <bit>
+#include <cstring>
 #include <functional>
+#include <type_traits>
 #include <utility>
 
 #include "trippin/common.h"
 #include "trippin/memory.h"
 #include "trippin/string.h"
 
+// the hashmap compares 16 control bytes at once if it can
+#if defined(TR_ARCH_X86_64) || defined(__SSE2__)
+	#define TR_HASHMAP_SSE2
+	#include <emmintrin.h>
+#elif defined(TR_ARCH_ARM64) || defined(__ARM_NEON)
+	#define TR_HASHMAP_NEON
+	#include <arm_neon.h>
+#endif
+
+#ifdef TR_ONLY_MSVC
+	#include <intrin.h>
+#endif
+
 namespace tr {
 
+namespace _tr {
+	// multiplies 2 64-bit numbers into a 128-bit number, `a` gets the low half and `b` gets
+	// the high half
+	inline void wymum(uint64& a, uint64& b)
+	{
+#if defined(TR_GCC_OR_CLANG) && defined(TR_ARCH_64_BITS)
+		__extension__ typedef unsigned __int128 uint128;
+		uint128 r = static_cast<uint128>(a) * b;
+		a = static_cast<uint64>(r);
+		b = static_cast<uint64>(r >> 64);
+#elif defined(TR_ONLY_MSVC) && defined(TR_ARCH_X86_64)
+		uint64 hi;
+		a = _umul128(a, b, &hi);
+		b = hi;
+#else
+		// the slow way
+		uint64 ha = a >> 32;
+		uint64 hb = b >> 32;
+		uint64 la = static_cast<uint32>(a);
+		uint64 lb = static_cast<uint32>(b);
+		uint64 mid0 = ha * lb;
+		uint64 mid1 = hb * la;
+		uint64 t = la * lb + (mid0 << 32);
+		uint64 carry = t < (mid0 << 32);
+		uint64 lo = t + (mid1 << 32);
+		carry += lo < t;
+		a = lo;
+		b = ha * hb + (mid0 >> 32) + (mid1 >> 32) + carry;
+#endif
+	}
+
+	// the wyhash mixing function, every bit of the result depends on every bit of the input
+	inline uint64 wymix(uint64 a, uint64 b)
+	{
+		wymum(a, b);
+		return a ^ b;
+	}
+
+	constexpr uint64 WYHASH_SECRET[4] = {
+		0x2d358dccaa6c78a5,
+		0x8bb84b93962eacc9,
+		0x4b33a62ed433d4a3,
+		0x4d5a2da51de1aa47,
+	};
+} // namespace _tr
+
 // Hashes an array of bytes, which is useful if you need to hash an array of bytes. Implemented with
-// 64-bit FNV-1a
-uint64 hash(const uint8* bytes, usize len);
+// 64-bit wyhash, which goes through 8 bytes at a time (48 for long keys), so it's a lot faster
+// than byte-at-a-time hashes.
+uint64 hash(const uint8* bytes, usize len, uint64 seed = 0);
+
+// The old hash function, which is 64-bit FNV-1a. It's a lot slower than `tr::hash()` but it's
+// simple enough to implement anywhere, so it's useful if something else has to get the same
+// hashes.
+uint64 hash_fnv1a(const uint8* bytes, usize len);
+
+// Hashes a single integer, with 2 multiplications, which is a lot faster than hashing its bytes.
+// Hashmaps need every bit of the hash to depend on every bit of the key, so just using the integer
+// itself doesn't work.
+inline uint64 hash_int(uint64 x)
+{
+	uint64 a = x ^ _tr::WYHASH_SECRET[0];
+	uint64 b = _tr::WYHASH_SECRET[1];
+	_tr::wymum(a, b);
+	return _tr::wymix(a ^ _tr::WYHASH_SECRET[0], b ^ _tr::WYHASH_SECRET[1]);
+}
 
 // internal don't use probably :)
 template<typename K>
 uint64 _default_hash_function(const K& key)
 {
-	return tr::hash(reinterpret_cast<const uint8*>(&key), sizeof(K));
+	if constexpr (std::is_integral_v<K> || std::is_enum_v<K>) {
+		return tr::hash_int(static_cast<uint64>(key));
+	}
+	else if constexpr (std::is_pointer_v<K>) {
+		return tr::hash_int(reinterpret_cast<usize>(key));
+	}
+	else {
+		return tr::hash(reinterpret_cast<const uint8*>(&key), sizeof(K));
+	}
 }
 // internal don't use probably :)
 template<>
@@ -52,297 +139,1872 @@ inline uint64 _default_hash_function<String>(const String& key)
 	return tr::hash(reinterpret_cast<const uint8*>(key.buf()), key.len());
 }
 
-// Useful for when you need *advanced* hashmaps
-template<typename K>
-struct HashMapSettings
-{
-	float64 load_factor;
-	usize initial_capacity;
-	uint64 (*hash_func)(const K& key);
+// Lets hashmaps with K keys look things up with a Q, without turning it into a K first. `hash()`
+// has to return the same hash the default hash function would give a K with the same contents,
+// and `K == Q` has to work. Specialize it for your own types if you need to.
+template<typename K, typename Q>
+struct HashLookup
+{
+};
+
+template<>
+struct HashLookup<String, const char*>
+{
+	static uint64 hash(const char* key)
+	{
+		return tr::hash(reinterpret_cast<const uint8*>(key), std::strlen(key));
+	}
+};
+
+template<>
+struct HashLookup<String, char*> : HashLookup<String, const char*>
+{
+};
+
+template<>
+struct HashLookup<String, StringBuilder>
+{
+	static uint64 hash(const StringBuilder& key)
+	{
+		return tr::hash(reinterpret_cast<const uint8*>(key.buf()), key.len());
+	}
+};
+
+// Any type you can look up in a `tr::HashMap<K, V>` instead of K, see `tr::HashLookup<K, Q>`
+template<typename K, typename Q>
+concept LookupKey = !std::is_same_v<K, Q> && requires(const K& k, const Q& q) {
+	HashLookup<K, Q>::hash(q);
+	k == q;
+};
+
+// Useful for when you need *advanced* hashmaps
+template<typename K>
+struct HashMapSettings
+{
+	float64 load_factor;
+	usize initial_capacity;
+	uint64 (*hash_func)(const K& key);
+	// If true, growing doesn't move every key at once. The old table sticks around and every
+	// insert/remove moves a few keys, so no single insert has to pay for moving everything.
+	// Lookups are a bit slower while that's happening, since the key could be in either
+	// table.
+	bool incremental_rehash = false;
+};
+
+namespace _tr {
+	// swiss table crap. every slot has a control byte: empty, deleted, or the bottom 7 bits of
+	// the hash when it's full. control bytes are checked 16 at a time (a "group") so most
+	// lookups compare a single group and maybe 1 key
+	constexpr usize HASHMAP_GROUP_LEN = 16;
+	constexpr int8 HASHMAP_EMPTY = -128; // 0b1000'0000
+	constexpr int8 HASHMAP_DELETED = -2; // 0b1111'1110
+	// full slots are 0b0xxx'xxxx so they're never negative
+
+	// how many slots of the old table every insert/remove moves when growing incrementally.
+	// the new table has space for at least ~3/4 of the old capacity before it has to grow
+	// again, so this is plenty to finish in time
+	constexpr usize HASHMAP_MIGRATE_STEP = HASHMAP_GROUP_LEN * 2;
+
+	constexpr bool hashmap_is_full(int8 ctrl)
+	{
+		return ctrl >= 0;
+	}
+
+	// the top 57 bits decide where to start probing
+	constexpr usize hashmap_h1(uint64 hash)
+	{
+		return static_cast<usize>(hash >> 7);
+	}
+
+	// the bottom 7 bits go in the control byte
+	constexpr int8 hashmap_h2(uint64 hash)
+	{
+		return static_cast<int8>(hash & 0x7f);
+	}
+
+	// a bit for every slot in a group that matched. on NEON every slot is 4 bits instead of 1,
+	// which is still faster than the alternative
+	struct HashMapMask
+	{
+		uint64 bits;
+		static constexpr int SHIFT =
+#ifdef TR_HASHMAP_NEON
+			2;
+#else
+			0;
+#endif
+
+		explicit operator bool() const
+		{
+			return bits != 0;
+		}
+
+		// index of the first match in the group
+		usize lowest() const
+		{
+			return static_cast<usize>(std::countr_zero(bits)) >> SHIFT;
+		}
+
+		// how many slots at the start of the group didn't match
+		usize trailing_zeros() const
+		{
+			return bits == 0 ? HASHMAP_GROUP_LEN : lowest();
+		}
+
+		// how many slots at the end of the group didn't match
+		usize leading_zeros() const
+		{
+			constexpr int UNUSED = 64 - static_cast<int>(HASHMAP_GROUP_LEN << SHIFT);
+			return static_cast<usize>(std::countl_zero(bits) - UNUSED) >> SHIFT;
+		}
+
+		void clear_lowest()
+		{
+			bits &= bits - 1;
+		}
+	};
+
+	// 16 control bytes, compared all at once if the CPU can do that
+	struct HashMapGroup
+	{
+#if defined(TR_HASHMAP_SSE2)
+		__m128i ctrl;
+
+		explicit HashMapGroup(const int8* pos)
+			: ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)))
+		{
+		}
+
+		HashMapMask match(int8 h2) const
+		{
+			__m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl);
+			return {static_cast<uint64>(static_cast<uint32>(_mm_movemask_epi8(eq)))};
+		}
+
+		HashMapMask match_empty() const
+		{
+			return match(HASHMAP_EMPTY);
+		}
+
+		// empty and deleted are the only negative numbers other than -1, which isn't used
+		HashMapMask match_empty_or_deleted() const
+		{
+			__m128i lt = _mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl);
+			return {static_cast<uint64>(static_cast<uint32>(_mm_movemask_epi8(lt)))};
+		}
+#elif defined(TR_HASHMAP_NEON)
+		int8x16_t ctrl;
+
+		explicit HashMapGroup(const int8* pos)
+			: ctrl(vld1q_s8(pos))
+		{
+		}
+
+		// neon doesn't have movemask so this squishes every byte into 4 bits
+		static HashMapMask to_mask(uint8x16_t cmp)
+		{
+			uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+			uint64 bits = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+			return {bits & 0x8888888888888888ull};
+		}
+
+		HashMapMask match(int8 h2) const
+		{
+			return to_mask(vceqq_s8(ctrl, vdupq_n_s8(h2)));
+		}
+
+		HashMapMask match_empty() const
+		{
+			return match(HASHMAP_EMPTY);
+		}
+
+		HashMapMask match_empty_or_deleted() const
+		{
+			return to_mask(vcltq_s8(ctrl, vdupq_n_s8(-1)));
+		}
+#else
+		// the boring way
+		const int8* ctrl;
+
+		explicit HashMapGroup(const int8* pos)
+			: ctrl(pos)
+		{
+		}
+
+		HashMapMask match(int8 h2) const
+		{
+			uint64 bits = 0;
+			for (usize i = 0; i < HASHMAP_GROUP_LEN; i++) {
+				bits |= static_cast<uint64>(ctrl[i] == h2) << i;
+			}
+			return {bits};
+		}
+
+		HashMapMask match_empty() const
+		{
+			return match(HASHMAP_EMPTY);
+		}
+
+		HashMapMask match_empty_or_deleted() const
+		{
+			uint64 bits = 0;
+			for (usize i = 0; i < HASHMAP_GROUP_LEN; i++) {
+				bits |= static_cast<uint64>(ctrl[i] < -1) << i;
+			}
+			return {bits};
+		}
+#endif
+	};
+} // namespace _tr
+
+namespace _tr {
+	// the actual swiss table, which is used by `tr::HashMap<K, V>` and `tr::HashSet<K>`. if
+	// you're interested, the slots (keys and whatever else `Slot` has) live in one array, and
+	// there's a separate array of control bytes with 7 bits of each key's hash. lookups check
+	// 16 control bytes at once with SIMD, and only compare keys when those 7 bits match.
+	template<typename K, typename Slot>
+	class HashTable
+	{
+		HashMapSettings<K> _settings{};
+
+		Arena* _arena = nullptr;
+		// there's `_cap + HASHMAP_GROUP_LEN - 1` control bytes, the last ones are copies of
+		// the first ones so loading a group near the end doesn't have to wrap around
+		int8* _ctrl = nullptr;
+		Slot* _slots = nullptr;
+
+		usize _len = 0;
+		// deleted slots still make probing slower, so they count towards growing
+		usize _tombstones = 0;
+		usize _cap = 0;
+		// how many slots can be used (including tombstones) before it has to grow
+		usize _growth_limit = 0;
+
+		// the table from before growing incrementally, null if that's not happening. slots
+		// before `_migrated` were already moved. `_len` counts keys in both tables, so the
+		// new one can't get full before everything's moved
+		int8* _old_ctrl = nullptr;
+		Slot* _old_slots = nullptr;
+		usize _old_cap = 0;
+		usize _migrated = 0;
+
+		// there always has to be an empty slot, or failed lookups never stop probing
+		usize _growth_limit_for(usize cap) const
+		{
+			float64 limit = static_cast<float64>(cap) * _settings.load_factor;
+			return tr::clamp(static_cast<usize>(limit), usize{1}, cap - 1);
+		}
+
+		// the smallest capacity where that many keys fit without growing
+		usize _cap_for(usize keys) const
+		{
+			usize cap = HASHMAP_GROUP_LEN;
+			while (_growth_limit_for(cap) < keys) {
+				cap <<= 1;
+			}
+			return cap;
+		}
+
+		// allocates empty control bytes and slots for that capacity, which has to be a
+		// power of 2
+		void _alloc_table(usize cap)
+		{
+			usize ctrl_len = cap + HASHMAP_GROUP_LEN - 1;
+			_cap = cap;
+			_ctrl = static_cast<int8*>(_arena->alloc(ctrl_len, 1));
+			std::memset(_ctrl, static_cast<uint8>(HASHMAP_EMPTY), ctrl_len);
+			usize slots_size = cap * sizeof(Slot);
+			_slots = static_cast<Slot*>(_arena->alloc(slots_size, alignof(Slot)));
+			_growth_limit = _growth_limit_for(cap);
+		}
+
+		static void _set_ctrl_in(int8* ctrl, usize cap, usize idx, int8 value)
+		{
+			// also update the copy at the end (if it's one of the first slots,
+			// otherwise this is the same byte)
+			constexpr usize CLONED = HASHMAP_GROUP_LEN - 1;
+			ctrl[idx] = value;
+			ctrl[((idx - CLONED) & (cap - 1)) + CLONED] = value;
+		}
+
+		// returns the index of the slot with that key in that table, or -1
+		template<typename Q>
+		static isize _probe(const int8* ctrl, const Slot* slots, usize cap, const Q& key,
+			uint64 hash)
+		{
+			usize mask = cap - 1;
+			usize pos = hashmap_h1(hash) & mask;
+			int8 h2 = hashmap_h2(hash);
+
+			// triangular probing, which visits every group once since the capacity is a
+			// power of 2
+			for (usize stride = HASHMAP_GROUP_LEN;; stride += HASHMAP_GROUP_LEN) {
+				HashMapGroup group{ctrl + pos};
+				for (HashMapMask m = group.match(h2); m; m.clear_lowest()) {
+					usize idx = (pos + m.lowest()) & mask;
+					if (slots[idx].key == key) {
+						return static_cast<isize>(idx);
+					}
+				}
+
+				// if the key was there it'd be before the first empty slot
+				if (group.match_empty()) {
+					return -1;
+				}
+				pos = (pos + stride) & mask;
+			}
+		}
+
+		// starts growing incrementally to that capacity. nothing is moved yet
+		void _start_migration(usize new_cap)
+		{
+			_old_ctrl = _ctrl;
+			_old_slots = _slots;
+			_old_cap = _cap;
+			_migrated = 0;
+			_alloc_table(new_cap);
+			_tombstones = 0;
+		}
+
+		// moves a key from the old table to the new one. it becomes a tombstone in the old
+		// table, since other keys that haven't been moved yet could've probed past it
+		usize _migrate_slot(usize old_idx, uint64 hash)
+		{
+			usize idx = _find_insert_slot(hash);
+			// removing while moving things leaves tombstones in the new table too
+			if (_ctrl[idx] == HASHMAP_DELETED) {
+				_tombstones--;
+			}
+			_set_ctrl(idx, hashmap_h2(hash));
+			new (&_slots[idx]) Slot(std::move(_old_slots[old_idx]));
+			_set_ctrl_in(_old_ctrl, _old_cap, old_idx, HASHMAP_DELETED);
+			return idx;
+		}
+
+		// moves a few more keys from the old table, if there's an old table
+		void _migrate_step(usize slots)
+		{
+			if (_old_ctrl == nullptr) [[likely]] {
+				return;
+			}
+
+			usize end = tr::min(_migrated + slots, _old_cap);
+			for (usize i = _migrated; i < end; i++) {
+				if (hashmap_is_full(_old_ctrl[i])) {
+					_migrate_slot(i, _settings.hash_func(_old_slots[i].key));
+				}
+			}
+			_migrated = end;
+
+			if (_migrated == _old_cap) {
+				_old_ctrl = nullptr;
+				_old_slots = nullptr;
+				_old_cap = 0;
+				_migrated = 0;
+			}
+		}
+
+		void _finish_migration()
+		{
+			_migrate_step(_old_cap);
+		}
+
+		// moves everything to a new table with that capacity, dropping tombstones
+		void _resize(usize new_cap)
+		{
+			_finish_migration();
+			int8* old_ctrl = _ctrl;
+			Slot* old_slots = _slots;
+			usize old_cap = _cap;
+			_alloc_table(new_cap);
+			_tombstones = 0;
+
+			// changing the capacity fucks with the hashing so we have to move
+			// everything to new indexes. no need to compare keys, they're all different
+			// already
+			for (usize i = 0; i < old_cap; i++) {
+				if (!hashmap_is_full(old_ctrl[i])) {
+					continue;
+				}
+
+				uint64 hash = _settings.hash_func(old_slots[i].key);
+				usize idx = _find_insert_slot(hash);
+				_set_ctrl(idx, hashmap_h2(hash));
+				new (&_slots[idx]) Slot(std::move(old_slots[i]));
+			}
+		}
+
+		// gets rid of every tombstone without allocating anything. the old table stays in
+		// the arena when resizing, so for long-lived maps with a lot of removing this is
+		// the difference between a fixed size and growing forever
+		void _rehash_in_place()
+		{
+			// full slots become "deleted" which here means "not moved yet", and
+			// tombstones become empty
+			for (usize i = 0; i < _cap; i++) {
+				bool full = hashmap_is_full(_ctrl[i]);
+				_ctrl[i] = full ? HASHMAP_DELETED : HASHMAP_EMPTY;
+			}
+			std::memcpy(_ctrl + _cap, _ctrl, HASHMAP_GROUP_LEN - 1);
+
+			usize mask = _cap - 1;
+			for (usize i = 0; i < _cap; i++) {
+				if (_ctrl[i] != HASHMAP_DELETED) {
+					continue;
+				}
+
+				uint64 hash = _settings.hash_func(_slots[i].key);
+				usize start = hashmap_h1(hash) & mask;
+				usize target = _find_insert_slot(hash);
+				int8 h2 = hashmap_h2(hash);
+
+				// if it'd land in the same group it might as well stay here
+				usize group = ((i - start) & mask) / HASHMAP_GROUP_LEN;
+				usize target_group = ((target - start) & mask) / HASHMAP_GROUP_LEN;
+				if (group == target_group) {
+					_set_ctrl(i, h2);
+					continue;
+				}
+
+				if (_ctrl[target] == HASHMAP_EMPTY) {
+					new (&_slots[target]) Slot(std::move(_slots[i]));
+					_set_ctrl(target, h2);
+					_set_ctrl(i, HASHMAP_EMPTY);
+				}
+				else {
+					// the target hasn't been moved yet either, so swap them and
+					// check whatever's here now again
+					Slot tmp = std::move(_slots[target]);
+					_slots[target] = std::move(_slots[i]);
+					_slots[i] = std::move(tmp);
+					_set_ctrl(target, h2);
+					i--;
+				}
+			}
+
+			_tombstones = 0;
+		}
+
+		void _set_ctrl(usize idx, int8 ctrl)
+		{
+			_set_ctrl_in(_ctrl, _cap, idx, ctrl);
+		}
+
+		// returns the first empty or deleted slot where a key with that hash could go
+		usize _find_insert_slot(uint64 hash) const
+		{
+			usize mask = _cap - 1;
+			usize pos = hashmap_h1(hash) & mask;
+
+			for (usize stride = HASHMAP_GROUP_LEN;; stride += HASHMAP_GROUP_LEN) {
+				HashMapGroup group{_ctrl + pos};
+				HashMapMask m = group.match_empty_or_deleted();
+				if (m) {
+					return (pos + m.lowest()) & mask;
+				}
+				pos = (pos + stride) & mask;
+			}
+		}
+
+		// puts the key in that free slot, growing first if it has to
+		usize _insert_at(usize idx, const K& key, uint64 hash)
+		{
+			// reusing a tombstone doesn't make it any fuller. otherwise growing moves
+			// everything around, so it has to look for a free slot again
+			if (_ctrl[idx] == HASHMAP_EMPTY && _len + _tombstones >= _growth_limit) {
+				check_grow();
+				idx = _find_insert_slot(hash);
+			}
+			if (_ctrl[idx] == HASHMAP_DELETED) {
+				_tombstones--;
+			}
+
+			_set_ctrl(idx, hashmap_h2(hash));
+			_len++;
+			new (&_slots[idx].key) RefWrapper<K>(key);
+			return idx;
+		}
+
+	public:
+		static constexpr HashMapSettings<K> DEFAULT_SETTINGS = {
+			.load_factor = 0.875,
+			.initial_capacity = 256,
+			.hash_func = tr::_default_hash_function,
+			.incremental_rehash = false,
+		};
+
+		HashTable() {}
+
+		HashTable(Arena& arena, HashMapSettings<K> settings)
+			: _settings(settings)
+			, _arena(&arena)
+		{
+			usize cap = HASHMAP_GROUP_LEN;
+			while (cap < _settings.initial_capacity) {
+				cap <<= 1;
+			}
+			_alloc_table(cap);
+		}
+
+		bool initialized() const
+		{
+			return _ctrl != nullptr;
+		}
+
+		uint64 hash(const K& key) const
+		{
+			return _settings.hash_func(key);
+		}
+
+		// transparent lookup uses `tr::HashLookup<K, Q>`, which only matches the default
+		// hash function. with a custom one it has to make a K and hash that instead, or
+		// it'd never find anything
+		template<typename Q>
+		uint64 lookup_hash(const Q& key) const
+		{
+			if (_settings.hash_func != DEFAULT_SETTINGS.hash_func) [[unlikely]] {
+				if constexpr (std::is_constructible_v<K, const Q&>) {
+					return _settings.hash_func(K(key));
+				}
+				else {
+					tr::panic(
+						"looking up a different key type only works "
+						"with the default hash function, use "
+						"find_with_hash() instead"
+					);
+				}
+			}
+			return HashLookup<K, Q>::hash(key);
+		}
+
+		// true if both tables would hash a key the same way, so a hash from one works in
+		// the other
+		bool same_hash(const HashTable& other) const
+		{
+			return _settings.hash_func == other._settings.hash_func;
+		}
+
+		// returns the index of the slot with that key, or -1 if it's not there. the key
+		// can be anything that can be compared with a K. while growing incrementally,
+		// keys in the old table get indexes after the new table's capacity
+		template<typename Q>
+		isize find(const Q& key, uint64 hash) const
+		{
+			isize idx = _probe(_ctrl, _slots, _cap, key, hash);
+			if (idx != -1 || _old_ctrl == nullptr) [[likely]] {
+				return idx;
+			}
+
+			isize old_idx = _probe(_old_ctrl, _old_slots, _old_cap, key, hash);
+			return old_idx == -1 ? -1 : old_idx + static_cast<isize>(_cap);
+		}
+
+		// looks for the key, and if it's not there, adds it (only the key) where the
+		// probing found the first free slot, so it only probes once. returns the index and
+		// whether it was already there
+		Pair<usize, bool> find_or_insert(const K& key, uint64 hash)
+		{
+			_migrate_step(HASHMAP_MIGRATE_STEP);
+			if (_old_ctrl != nullptr) [[unlikely]] {
+				// it's getting moved anyway, might as well be now
+				isize old = _probe(_old_ctrl, _old_slots, _old_cap, key, hash);
+				if (old != -1) {
+					return {_migrate_slot(static_cast<usize>(old), hash), true};
+				}
+			}
+
+			usize mask = _cap - 1;
+			usize pos = hashmap_h1(hash) & mask;
+			int8 h2 = hashmap_h2(hash);
+			usize free_idx = 0;
+			bool has_free = false;
+
+			for (usize stride = HASHMAP_GROUP_LEN;; stride += HASHMAP_GROUP_LEN) {
+				HashMapGroup group{_ctrl + pos};
+				for (HashMapMask m = group.match(h2); m; m.clear_lowest()) {
+					usize idx = (pos + m.lowest()) & mask;
+					if (_slots[idx].key == key) {
+						return {idx, true};
+					}
+				}
+
+				HashMapMask free = group.match_empty_or_deleted();
+				if (!has_free && free) {
+					free_idx = (pos + free.lowest()) & mask;
+					has_free = true;
+				}
+				if (group.match_empty()) {
+					break;
+				}
+				pos = (pos + stride) & mask;
+			}
+
+			return {_insert_at(free_idx, key, hash), false};
+		}
+
+		// adds a key that you already know isn't there, so it doesn't compare any keys.
+		// returns the index
+		usize insert_new(const K& key, uint64 hash)
+		{
+			_migrate_step(HASHMAP_MIGRATE_STEP);
+			return _insert_at(_find_insert_slot(hash), key, hash);
+		}
+
+		template<typename Q>
+		bool remove(const Q& key, uint64 hash)
+		{
+			_migrate_step(HASHMAP_MIGRATE_STEP);
+			isize idx = find(key, hash);
+			// you can't kill someone that doesn't exist
+			// don't quote me on this
+			if (idx == -1) {
+				return false;
+			}
+
+			// nothing's ever inserted in the old table so it can always be a tombstone
+			if (static_cast<usize>(idx) >= _cap) {
+				usize old_idx = static_cast<usize>(idx) - _cap;
+				_set_ctrl_in(_old_ctrl, _old_cap, old_idx, HASHMAP_DELETED);
+				_len--;
+				return true;
+			}
+
+			// usually it has to be a tombstone, an empty slot would stop lookups for
+			// keys that probed past this one. but lookups only keep going if they see a
+			// whole group without empty slots, so if there's an empty slot close enough
+			// on both sides, nothing could've probed past this one
+			usize i = static_cast<usize>(idx);
+			usize before = (i - HASHMAP_GROUP_LEN) & (_cap - 1);
+			HashMapMask empty_after = HashMapGroup{_ctrl + i}.match_empty();
+			HashMapMask empty_before = HashMapGroup{_ctrl + before}.match_empty();
+			bool never_full = empty_before && empty_after &&
+				empty_after.trailing_zeros() + empty_before.leading_zeros() <
+					HASHMAP_GROUP_LEN;
+
+			if (never_full) {
+				_set_ctrl(i, HASHMAP_EMPTY);
+			}
+			else {
+				_set_ctrl(i, HASHMAP_DELETED);
+				_tombstones++;
+			}
+			_len--;
+			return true;
+		}
+
+		void grow()
+		{
+			_resize(_cap * 2);
+		}
+
+		void check_grow()
+		{
+			if (_len + _tombstones < _growth_limit) {
+				return;
+			}
+			// it's getting full before everything was moved, which only happens with
+			// really small load factors
+			_finish_migration();
+
+			// cleaning up tombstones happens all at once even when growing
+			// incrementally, since it doesn't have a second table to move things to
+			if (_len < _growth_limit / 2) {
+				_rehash_in_place();
+				return;
+			}
+
+			bool fits = _growth_limit_for(_cap * 2) > _len + 1;
+			if (_settings.incremental_rehash && fits) {
+				_start_migration(_cap * 2);
+				return;
+			}
+
+			// with a tiny load factor growing once may not be enough
+			while (_len + _tombstones >= _growth_limit) {
+				grow();
+			}
+		}
+
+		void reserve(usize keys)
+		{
+			usize cap = _cap_for(keys);
+			if (cap > _cap) {
+				_resize(cap);
+			}
+		}
+
+		void shrink_to_fit()
+		{
+			_finish_migration();
+			usize cap = _cap_for(_len + 1);
+			if (cap < _cap) {
+				_resize(cap);
+			}
+			else if (_tombstones > 0) {
+				_rehash_in_place();
+			}
+		}
+
+		Slot& slot(usize idx) const
+		{
+			if (idx >= _cap) [[unlikely]] {
+				return _old_slots[idx - _cap];
+			}
+			return _slots[idx];
+		}
+
+		// returns the first slot with a key starting at that index, or `slot_count()` if
+		// there's nothing else
+		usize next_full(usize idx) const
+		{
+			while (idx < _cap && !hashmap_is_full(_ctrl[idx])) {
+				idx++;
+			}
+			if (idx < _cap || _old_ctrl == nullptr) [[likely]] {
+				return idx;
+			}
+
+			while (idx < _cap + _old_cap && !hashmap_is_full(_old_ctrl[idx - _cap])) {
+				idx++;
+			}
+			return idx;
+		}
+
+		// how many slot indexes there are, which is more than the capacity while growing
+		// incrementally since the old table is still there
+		usize slot_count() const
+		{
+			return _cap + _old_cap;
+		}
+
+		HashMapSettings<K> settings() const
+		{
+			return _settings;
+		}
+
+		Arena& arena() const
+		{
+			return *_arena;
+		}
+
+		usize len() const
+		{
+			return _len;
+		}
+
+		usize cap() const
+		{
+			return _cap;
+		}
+	};
+} // namespace _tr
+
+// ahahsmhap :DD it's a swiss table, which is pretty fast, see `tr::_tr::HashTable` if you're
+// interested in how it works
+template<typename K, typename V>
+class HashMap
+{
+	// TODO references probably (definitely) don't work
+
+	struct Slot
+	{
+		RefWrapper<K> key;
+		RefWrapper<V> value;
+	};
+
+	_tr::HashTable<K, Slot> _table;
+
+	void _validate() const
+	{
+		if (!_table.initialized()) [[unlikely]] {
+			tr::panic("uninitialized tr::HashMap<K, V>!");
+		}
+	}
+
+	V& _value(usize idx) const
+	{
+		if constexpr (std::is_reference_v<V>) {
+			return *_table.slot(idx).value;
+		}
+		else {
+			return _table.slot(idx).value;
+		}
+	}
+
+public:
+	using KeyType = K;
+	using ValueType = V;
+
+	explicit HashMap(Arena& arena, HashMapSettings<K> settings)
+		: _table(arena, settings)
+	{
+	}
+
+	explicit HashMap(Arena& arena)
+		: HashMap(arena, _tr::HashTable<K, Slot>::DEFAULT_SETTINGS)
+	{
+	}
+
+	// man fuck you
+	HashMap() {}
+
+	// Makes a hashmap out of a bunch of pairs. It's sized for all of them from the start so it
+	// never grows, and keys are hashed in batches. If a key is there more than once, the last
+	// one wins.
+	[[nodiscard]]
+	static HashMap from_array(Arena& arena, Array<const Pair<K, V>> items,
+		HashMapSettings<K> settings = _tr::HashTable<K, Slot>::DEFAULT_SETTINGS)
+	requires(!std::is_reference_v<V>)
+	{
+		HashMap map{arena, settings};
+		map._table.reserve(items.len());
+
+		// hashing a batch first means the CPU can hash several keys at the same time
+		// instead of waiting for every probe
+		constexpr usize BATCH = 16;
+		uint64 hashes[BATCH];
+		for (usize start = 0; start < items.len(); start += BATCH) {
+			usize n = tr::min(BATCH, items.len() - start);
+			for (usize i = 0; i < n; i++) {
+				hashes[i] = map._table.hash(items[start + i].left);
+			}
+			for (usize i = 0; i < n; i++) {
+				const Pair<K, V>& item = items[start + i];
+				auto [idx, found] = map._table.find_or_insert(item.left, hashes[i]);
+				if (found) {
+					map._table.slot(idx).value = item.right;
+				}
+				else {
+					new (&map._table.slot(idx).value) V(item.right);
+				}
+			}
+		}
+		return map;
+	}
+
+	// Makes sure that many keys fit without growing, so if you know how many there'll be,
+	// inserting them doesn't have to move everything around a few times.
+	void reserve(usize keys)
+	{
+		_validate();
+		_table.reserve(keys);
+	}
+
+	// Doubles the capacity. Removed keys are dropped in the process.
+	void grow()
+	{
+		_validate();
+		_table.grow();
+	}
+
+	// Checks how full the hashmap is and resizes if necessary. If it's mostly removed keys,
+	// it cleans them up instead of growing.
+	void check_grow()
+	{
+		_validate();
+		_table.check_grow();
+	}
+
+	// Makes the hashmap as small as it can be while still fitting every key, and drops
+	// removed keys. The old table stays in the arena until the arena is freed, so this is
+	// mostly useful before copying the map somewhere else, or if the map lives in a
+	// `tr::ScratchArena` that's about to be freed.
+	void shrink_to_fit()
+	{
+		_validate();
+		_table.shrink_to_fit();
+	}
+
+	[[nodiscard]]
+	V& operator[](K key)
+	{
+		_validate();
+		// operator[] is also used for putting crap :)
+		auto [idx, found] = _table.find_or_insert(key, _table.hash(key));
+		if (!found) {
+			if constexpr (!std::is_reference_v<V>) {
+				new (&_table.slot(idx).value) V{};
+			}
+		}
+		return _value(idx);
+	}
+
+	// Returns the value for that key, and if it's not there, it adds whatever `func` returns
+	// first. Unlike `contains()` and then `operator[]`, the key is only hashed and looked up
+	// once.
+	template<typename Func>
+	V& get_or_insert_with(K key, Func func)
+	{
+		_validate();
+		auto [idx, found] = _table.find_or_insert(key, _table.hash(key));
+		if (!found) {
+			if constexpr (std::is_reference_v<V>) {
+				_table.slot(idx).value = &func();
+			}
+			else {
+				new (&_table.slot(idx).value) V(func());
+			}
+		}
+		return _value(idx);
+	}
+
+	// Returns the hash the hashmap uses for that key, for `find_with_hash()`
+	uint64 hash_key(const K& key) const
+	{
+		_validate();
+		return _table.hash(key);
+	}
+
+	// Like `try_get()`, but with a hash you already have (from `hash_key()`), so it doesn't
+	// hash the key again. Since it doesn't hash the key, it can be anything that can be
+	// compared with a K.
+	template<typename Q>
+	requires requires(const K& k, const Q& q) { k == q; }
+	Maybe<V&> find_with_hash(const Q& key, uint64 hash) const
+	{
+		_validate();
+		isize idx = _table.find(key, hash);
+		if (idx == -1) {
+			return {};
+		}
+		return _value(static_cast<usize>(idx));
+	}
+
+	// If true, the hashmap has that key. Useful because the `[]` operator automatically inserts
+	// an item if it's not there.
+	bool contains(K key) const
+	{
+		_validate();
+		return _table.find(key, _table.hash(key)) != -1;
+	}
+
+	// Same as `contains(K)` but it doesn't have to make a K first, e.g. a `const char*` or
+	// `tr::StringBuilder` for `tr::String` keys. See `tr::HashLookup<K, Q>`.
+	template<typename Q>
+	requires LookupKey<K, Q>
+	bool contains(const Q& key) const
+	{
+		_validate();
+		return _table.find(key, _table.lookup_hash(key)) != -1;
+	}
+
+	// Like `operator[]` but it doesn't add shit, returns null if the key wasn't found
+	Maybe<V&> try_get(K key) const
+	{
+		_validate();
+		return find_with_hash(key, _table.hash(key));
+	}
+
+	// Same as `try_get(K)` but it doesn't have to make a K first, e.g. a `const char*` or
+	// `tr::StringBuilder` for `tr::String` keys. See `tr::HashLookup<K, Q>`.
+	template<typename Q>
+	requires LookupKey<K, Q>
+	Maybe<V&> try_get(const Q& key) const
+	{
+		_validate();
+		return find_with_hash(key, _table.lookup_hash(key));
+	}
+
+	// Removes the key from the hashmap. Returns true if the key is was found, returns false
+	// otherwise.
+	bool remove(K key)
+	{
+		_validate();
+		return _table.remove(key, _table.hash(key));
+	}
+
+	// Same as `remove(K)` but it doesn't have to make a K first, e.g. a `const char*` or
+	// `tr::StringBuilder` for `tr::String` keys. See `tr::HashLookup<K, Q>`.
+	template<typename Q>
+	requires LookupKey<K, Q>
+	bool remove(const Q& key)
+	{
+		_validate();
+		return _table.remove(key, _table.lookup_hash(key));
+	}
+
+	// Returns how many items the hashmap currently has
+	usize len() const
+	{
+		_validate();
+		return _table.len();
+	}
+
+	// Returns the total amount of slots the hashmap currently has (it'll grow when it's 87.5%
+	// full by default)
+	usize cap() const
+	{
+		_validate();
+		return _table.cap();
+	}
+
+	// fucking iterator
+	class Iterator
+	{
+	public:
+		Iterator(const _tr::HashTable<K, Slot>* table, usize index)
+			: _table(table)
+			, _idx(table->next_full(index))
+		{
+		}
+
+		Pair<K&, V&> operator*() const
+		{
+			Slot& s = _table->slot(_idx);
+			return {s.key, s.value};
+		}
+
+		Iterator& operator++()
+		{
+			_idx = _table->next_full(_idx + 1);
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return _idx != other._idx;
+		}
+
+	private:
+		const _tr::HashTable<K, Slot>* _table;
+		usize _idx;
+	};
+
+	Iterator begin() const
+	{
+		_validate();
+		return Iterator(&_table, 0);
+	}
+
+	Iterator end() const
+	{
+		_validate();
+		return Iterator(&_table, _table.slot_count());
+	}
+};
+
+// A hashmap without values, so it's just keys. It's the same swiss table as `tr::HashMap<K, V>`,
+// but it doesn't waste space on values you don't need.
+template<typename K>
+requires(!std::is_reference_v<K>)
+class HashSet
+{
+	struct Slot
+	{
+		K key;
+	};
+
+	_tr::HashTable<K, Slot> _table;
+
+	void _validate() const
+	{
+		if (!_table.initialized()) [[unlikely]] {
+			tr::panic("uninitialized tr::HashSet<K>!");
+		}
+	}
+
+	// the hash the other set would use, which is usually the same one
+	uint64 _other_hash(const HashSet& other, const K& key, uint64 hash) const
+	{
+		return _table.same_hash(other._table) ? hash : other._table.hash(key);
+	}
+
+public:
+	using KeyType = K;
+
+	explicit HashSet(Arena& arena, HashMapSettings<K> settings)
+		: _table(arena, settings)
+	{
+	}
+
+	explicit HashSet(Arena& arena)
+		: HashSet(arena, _tr::HashTable<K, Slot>::DEFAULT_SETTINGS)
+	{
+	}
+
+	// man fuck you
+	HashSet() {}
+
+	// Adds a key to the set. Returns true if it wasn't there before.
+	bool add(K key)
+	{
+		_validate();
+		return !_table.find_or_insert(key, _table.hash(key)).right;
+	}
+
+	// Adds a bunch of keys at once, and returns how many of them weren't there before. It only
+	// grows once, and hashes the keys in batches, which is faster than calling `add()` a lot.
+	usize insert_all(Array<const K> keys)
+	{
+		_validate();
+		_table.reserve(_table.len() + keys.len());
+
+		// hashing a batch first means the CPU can hash several keys at the same time
+		// instead of waiting for every probe
+		constexpr usize BATCH = 16;
+		uint64 hashes[BATCH];
+		usize added = 0;
+		for (usize start = 0; start < keys.len(); start += BATCH) {
+			usize n = tr::min(BATCH, keys.len() - start);
+			for (usize i = 0; i < n; i++) {
+				hashes[i] = _table.hash(keys[start + i]);
+			}
+			for (usize i = 0; i < n; i++) {
+				added += !_table.find_or_insert(keys[start + i], hashes[i]).right;
+			}
+		}
+		return added;
+	}
+
+	// If true, the set has that key. Shocking.
+	bool contains(K key) const
+	{
+		_validate();
+		return _table.find(key, _table.hash(key)) != -1;
+	}
+
+	// Same as `contains(K)` but it doesn't have to make a K first, e.g. a `const char*` or
+	// `tr::StringBuilder` for `tr::String` keys. See `tr::HashLookup<K, Q>`.
+	template<typename Q>
+	requires LookupKey<K, Q>
+	bool contains(const Q& key) const
+	{
+		_validate();
+		return _table.find(key, _table.lookup_hash(key)) != -1;
+	}
+
+	// Removes the key from the set. Returns true if the key is was found, returns false
+	// otherwise.
+	bool remove(K key)
+	{
+		_validate();
+		return _table.remove(key, _table.hash(key));
+	}
+
+	// Same as `remove(K)` but it doesn't have to make a K first, e.g. a `const char*` or
+	// `tr::StringBuilder` for `tr::String` keys. See `tr::HashLookup<K, Q>`.
+	template<typename Q>
+	requires LookupKey<K, Q>
+	bool remove(const Q& key)
+	{
+		_validate();
+		return _table.remove(key, _table.lookup_hash(key));
+	}
+
+	// Returns a new set (at an arena) with every key that's in either set. It grows at most
+	// once, and keys from this set don't have to be compared with anything.
+	HashSet unite(Arena& arena, const HashSet& other) const
+	{
+		_validate();
+		other._validate();
+		HashSet result{arena, _table.settings()};
+		result._table.reserve(len() + other.len());
+
+		for (const K& key : *this) {
+			result._table.insert_new(key, _table.hash(key));
+		}
+		for (const K& key : other) {
+			uint64 hash = other._other_hash(result, key, other._table.hash(key));
+			(void)result._table.find_or_insert(key, hash);
+		}
+		return result;
+	}
+
+	// Returns a new set (at an arena) with every key that's in both sets. It goes through the
+	// smaller set, and every key is only hashed once.
+	HashSet intersect(Arena& arena, const HashSet& other) const
+	{
+		_validate();
+		other._validate();
+		const HashSet& small = len() <= other.len() ? *this : other;
+		const HashSet& big = len() <= other.len() ? other : *this;
+		HashSet result{arena, _table.settings()};
+		result._table.reserve(small.len());
+
+		for (const K& key : small) {
+			uint64 hash = small._table.hash(key);
+			if (big._table.find(key, small._other_hash(big, key, hash)) != -1) {
+				result._table.insert_new(key, small._other_hash(result, key, hash));
+			}
+		}
+		return result;
+	}
+
+	// Returns a new set (at an arena) with every key in this set that isn't in the other set.
+	// Every key is only hashed once.
+	HashSet difference(Arena& arena, const HashSet& other) const
+	{
+		_validate();
+		other._validate();
+		HashSet result{arena, _table.settings()};
+		result._table.reserve(len());
+
+		for (const K& key : *this) {
+			uint64 hash = _table.hash(key);
+			if (other._table.find(key, _other_hash(other, key, hash)) == -1) {
+				result._table.insert_new(key, hash);
+			}
+		}
+		return result;
+	}
+
+	// Makes the set big enough for that many keys, so adding them doesn't have to grow it
+	void reserve(usize keys)
+	{
+		_validate();
+		_table.reserve(keys);
+	}
+
+	// Makes the set as small as it can be while still fitting every key, and drops removed
+	// keys. The old table stays in the arena until the arena is freed.
+	void shrink_to_fit()
+	{
+		_validate();
+		_table.shrink_to_fit();
+	}
+
+	// Returns how many keys the set currently has
+	usize len() const
+	{
+		_validate();
+		return _table.len();
+	}
+
+	// Returns the total amount of slots the set currently has (it'll grow when it's 87.5% full
+	// by default)
+	usize cap() const
+	{
+		_validate();
+		return _table.cap();
+	}
+
+	class Iterator
+	{
+	public:
+		Iterator(const _tr::HashTable<K, Slot>* table, usize index)
+			: _table(table)
+			, _idx(table->next_full(index))
+		{
+		}
+
+		// you can't change the keys, that would fuck up the hashing
+		const K& operator*() const
+		{
+			return _table->slot(_idx).key;
+		}
+
+		Iterator& operator++()
+		{
+			_idx = _table->next_full(_idx + 1);
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return _idx != other._idx;
+		}
+
+	private:
+		const _tr::HashTable<K, Slot>* _table;
+		usize _idx;
+	};
+
+	Iterator begin() const
+	{
+		_validate();
+		return Iterator(&_table, 0);
+	}
+
+	Iterator end() const
+	{
+		_validate();
+		return Iterator(&_table, _table.slot_count());
+	}
 };
 
-// ahahsmhap :DD if you're interested this works with open addressing and linear probing, i'll
-// probably change it if my brain expands to megamind levels of brain
+// A map that's just a sorted array of keys and an array of values, and it uses binary search to
+// find things. For small maps that you mostly read from, it's usually faster than a hashmap since
+// it doesn't have to hash anything and the keys are all next to each other. Adding and removing
+// keys has to move everything after them, so it's slow for big maps. K has to have `<` and `==`.
 template<typename K, typename V>
-class HashMap
+requires(!std::is_reference_v<K> && !std::is_reference_v<V>)
+class FlatMap
 {
-	// TODO references probably (definitely) don't work
+	Arena* _arena = nullptr;
+	K* _keys = nullptr;
+	V* _values = nullptr;
+	usize _len = 0;
+	usize _cap = 0;
 
-	static constexpr HashMapSettings<K> DEFAULT_SETTINGS = {
-		.load_factor = 0.5,
-		.initial_capacity = 256,
-		.hash_func = tr::_default_hash_function,
-	};
-
-	struct Bucket
+	void _validate() const
 	{
-		RefWrapper<K> key{};
-		RefWrapper<V> value{};
-		bool occupied = false;
-		bool dead = false;
-	};
+		if (_keys == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::FlatMap<K, V>!");
+		}
+	}
 
-	HashMapSettings<K> settings;
+	void _grow(usize new_cap)
+	{
+		K* keys = static_cast<K*>(_arena->alloc(new_cap * sizeof(K), alignof(K)));
+		V* values = static_cast<V*>(_arena->alloc(new_cap * sizeof(V), alignof(V)));
+		if (_len > 0) {
+			tr::_move_construct_items<K>(keys, _keys, _len);
+			tr::_move_construct_items<V>(values, _values, _len);
+		}
+		_keys = keys;
+		_values = values;
+		_cap = new_cap;
+	}
 
-	Arena* src_arena = nullptr;
-	Bucket* buffer = nullptr;
+	// the index of the first key that isn't less than that key
+	usize _lower_bound(const K& key) const
+	{
+		usize lo = 0;
+		usize len = _len;
+		while (len > 0) {
+			usize half = len / 2;
+			if (_keys[lo + half] < key) {
+				lo += half + 1;
+				len -= half + 1;
+			}
+			else {
+				len = half;
+			}
+		}
+		return lo;
+	}
 
-	// occupied includes removed keys, length doesn't
-	usize occupied = 0;
-	usize length = 0;
-	usize capacity = 0;
+	// returns the index of that key, or -1 if it's not there
+	isize _find(const K& key) const
+	{
+		usize idx = _lower_bound(key);
+		if (idx < _len && _keys[idx] == key) {
+			return static_cast<isize>(idx);
+		}
+		return -1;
+	}
 
-	void _validate() const
+	// adds a key (and an empty value) at that index, moving everything after it to the right
+	void _insert_at(usize idx, K key)
 	{
-		if (buffer == nullptr || capacity == 0) {
-			tr::panic("uninitialized tr::HashMap<K, V>!");
+		if (_len == _cap) {
+			_grow(_cap * 2);
+		}
+
+		if (idx == _len) {
+			new (&_keys[idx]) K(std::move(key));
+			new (&_values[idx]) V{};
+			_len++;
+			return;
+		}
+
+		// the last slot isn't initialized yet
+		new (&_keys[_len]) K(std::move(_keys[_len - 1]));
+		new (&_values[_len]) V(std::move(_values[_len - 1]));
+		for (usize i = _len - 1; i > idx; i--) {
+			_keys[i] = std::move(_keys[i - 1]);
+			_values[i] = std::move(_values[i - 1]);
 		}
+		_keys[idx] = std::move(key);
+		_values[idx] = V{};
+		_len++;
 	}
 
 public:
 	using KeyType = K;
 	using ValueType = V;
 
-	explicit HashMap(Arena& arena, HashMapSettings<K> setting)
-		: settings(setting)
-		, src_arena(&arena)
+	// Initializes an empty map at an arena. It grows by itself, the capacity is just how much
+	// it can hold before it has to.
+	explicit FlatMap(Arena& arena, usize capacity = 8)
+		: _arena(&arena)
 	{
-		this->capacity = this->settings.initial_capacity;
-		this->buffer = static_cast<Bucket*>(
-			this->src_arena->alloc(this->settings.initial_capacity * sizeof(Bucket))
-		);
-		tr::strlib::explicit_memset(
-			this->buffer, this->settings.initial_capacity * sizeof(Bucket), 0
-		);
+		_grow(tr::max(capacity, usize{1}));
 	}
 
-	explicit HashMap(Arena& arena)
-		: HashMap(arena, DEFAULT_SETTINGS)
+	// man fuck you
+	FlatMap() {}
+
+	// Returns the value for that key, and if it's not there, it adds it first.
+	[[nodiscard]]
+	V& operator[](K key)
+	{
+		_validate();
+		usize idx = _lower_bound(key);
+		if (idx == _len || !(_keys[idx] == key)) {
+			_insert_at(idx, std::move(key));
+		}
+		return _values[idx];
+	}
+
+	// If true, the map has that key.
+	bool contains(const K& key) const
 	{
+		_validate();
+		return _find(key) != -1;
 	}
 
-	// man fuck you
-	HashMap() {}
+	// Like `operator[]` but it doesn't add shit, returns null if the key wasn't found
+	Maybe<V&> try_get(const K& key) const
+	{
+		_validate();
+		isize idx = _find(key);
+		if (idx == -1) {
+			return {};
+		}
+		return _values[idx];
+	}
 
-	// Returns the index based on a key. That's how hash maps work.
-	usize get_index(K key) const
+	// Removes the key from the map. Returns true if the key is was found, returns false
+	// otherwise.
+	bool remove(const K& key)
 	{
-		return this->settings.hash_func(key) % this->capacity;
+		_validate();
+		isize idx = _find(key);
+		if (idx == -1) {
+			return false;
+		}
+
+		for (usize i = static_cast<usize>(idx); i + 1 < _len; i++) {
+			_keys[i] = std::move(_keys[i + 1]);
+			_values[i] = std::move(_values[i + 1]);
+		}
+		_len--;
+		return true;
 	}
 
-	void grow()
+	// Makes the map big enough for that many more keys, so adding them doesn't have to grow it
+	void reserve(usize keys)
 	{
 		_validate();
+		if (_len + keys > _cap) {
+			_grow(tr::max(_cap * 2, _len + keys));
+		}
+	}
 
-		usize old_cap = this->capacity;
-		this->capacity *= 2;
-		Bucket* new_buffer = static_cast<Bucket*>(
-			this->src_arena->alloc(this->capacity * sizeof(Bucket))
-		);
-		tr::strlib::explicit_memset(new_buffer, this->capacity * sizeof(Bucket), 0);
+	// Returns the keys, sorted. The array points to the map, so it's only valid until the map
+	// changes.
+	Array<const K> keys() const
+	{
+		_validate();
+		return {_keys, _len};
+	}
 
-		// changing the capacity fucks with the hashing
-		// so we have to copy everything to new indexes
-		for (usize i = 0; i < old_cap; i++) {
-			Bucket& old_bucket = buffer[i];
-			if (!old_bucket.occupied) {
-				continue;
-			}
+	// Returns the values, in the same order as the keys. The array points to the map, so it's
+	// only valid until the map changes.
+	Array<V> values() const
+	{
+		_validate();
+		return {_values, _len};
+	}
 
-			usize idx = this->get_index(old_bucket.key);
+	// Returns how many items the map currently has
+	usize len() const
+	{
+		_validate();
+		return _len;
+	}
 
-			for (usize probe = idx;; probe = (probe + 1) % this->capacity) {
-				Bucket& new_bucket = new_buffer[probe];
-				if (!new_bucket.occupied) {
-					new_bucket.occupied = true;
-					new_bucket.dead = old_bucket.dead;
-					new_bucket.key = old_bucket.key;
-					new_bucket.value = old_bucket.value;
-					break;
-				}
-			}
+	class Iterator
+	{
+	public:
+		Iterator(const FlatMap* map, usize index)
+			: _map(map)
+			, _idx(index)
+		{
+		}
+
+		Pair<const K&, V&> operator*() const
+		{
+			return {_map->_keys[_idx], _map->_values[_idx]};
+		}
+
+		Iterator& operator++()
+		{
+			_idx++;
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return _idx != other._idx;
 		}
 
-		this->buffer = new_buffer;
+	private:
+		const FlatMap* _map;
+		usize _idx;
+	};
+
+	Iterator begin() const
+	{
+		_validate();
+		return Iterator(this, 0);
 	}
 
-	// Checks how full the hashmap is and resizes if necessary
-	void check_grow()
+	Iterator end() const
 	{
 		_validate();
+		return Iterator(this, _len);
+	}
+};
 
-		// TODO you don't need a float here
-		float64 used =
-			static_cast<float64>(this->occupied) / static_cast<float64>(this->capacity);
+template<typename T>
+requires(!std::is_reference_v<T>)
+class Deque;
+
+// A queue with a fixed capacity (rounded up to a power of 2) that wraps around, so you can push and
+// pop from both ends in O(1) without shifting anything. If you want it to grow, use
+// `tr::Deque<T>`. Pass it by reference, copies share the buffer but not the head and tail, so
+// pushing to one overwrites items the other still thinks it has.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class RingBuffer
+{
+	friend class Deque<T>;
 
-		if (used <= this->settings.load_factor) {
-			return;
+	T* _buf = nullptr;
+	usize _cap = 0;
+	// these keep going up (or down), they wrap around when indexing the buffer. since the
+	// capacity is a power of 2 it still works when the usize overflows
+	usize _head = 0;
+	usize _tail = 0;
+
+	constexpr void _validate() const
+	{
+		if (_buf == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::RingBuffer<T>!");
 		}
-		this->grow();
 	}
 
-	// Returns the bucket and whether it's occupied (true for occupied, false for empty)
-	Pair<Bucket*, bool> find(K key) const
+	T* _slot(usize idx) const
 	{
-		_validate();
-		usize idx = this->get_index(key);
-		for (usize probe = idx;; probe = (probe + 1) % capacity) {
-			Bucket& b = this->buffer[probe];
-			if (b.occupied) {
-				if (b.key == key && !b.dead) {
-					return {&b, true};
-				}
-			}
-			// found an empty spot
-			else {
-				return {&b, false};
-			}
+		return &_buf[idx & (_cap - 1)];
+	}
+
+	// how many items there are from that index to the end of the buffer, before wrapping
+	usize _run(usize idx) const
+	{
+		return _cap - (idx & (_cap - 1));
+	}
+
+public:
+	using Type = T;
+
+	constexpr RingBuffer() {}
+
+	// Initializes a ring buffer at an arena. The capacity is rounded up to a power of 2.
+	RingBuffer(Arena& arena, usize capacity)
+	{
+		_cap = 1;
+		while (_cap < capacity) {
+			_cap <<= 1;
 		}
-		// if it's at the end, it wraps back to the beginning
-		// and there'll always be an empty spot since it resizes automatically
-		TR_UNREACHABLE();
+		_buf = static_cast<T*>(arena.alloc(_cap * sizeof(T), alignof(T)));
 	}
 
+	// Adds an item to the end. Returns false if it's full.
 	[[nodiscard]]
-	V& operator[](K key)
+	bool push_back(T val)
 	{
 		_validate();
-		// operator[] is also used for putting crap :)
-		this->check_grow();
-
-		// TODO put a _ before private members ffs
-		auto [bucket, b_occupied] = this->find(key);
-		// if it's empty, operator[] places some crap
-		if (!b_occupied) {
-			bucket->occupied = true;
-			bucket->key = key;
-			if constexpr (!std::is_reference_v<V>) {
-				bucket->value = V{};
-			}
-			this->occupied++;
-			this->length++;
+		if (len() == _cap) {
+			return false;
 		}
+		new (_slot(_tail)) T(std::move(val));
+		_tail++;
+		return true;
+	}
 
-		if constexpr (std::is_reference_v<V>) {
-			return *bucket->value;
+	// Adds an item to the start. Returns false if it's full.
+	[[nodiscard]]
+	bool push_front(T val)
+	{
+		_validate();
+		if (len() == _cap) {
+			return false;
 		}
-		else {
-			return bucket->value;
-		};
+		_head--;
+		new (_slot(_head)) T(std::move(val));
+		return true;
 	}
 
-	// If true, the hashmap has that key. Useful because the `[]` operator automatically inserts
-	// an item if it's not there.
-	bool contains(K key) const
+	// Removes the first item and returns it, or null if it's empty.
+	Maybe<T> pop_front()
 	{
 		_validate();
-		return this->find(key).right;
+		if (_head == _tail) {
+			return {};
+		}
+		T* slot = _slot(_head);
+		T val = std::move(*slot);
+		slot->~T();
+		_head++;
+		return val;
 	}
 
-	// Like `operator[]` but it doesn't add shit, returns null if the key wasn't found
-	Maybe<V&> try_get(K key) const
+	// Removes the last item and returns it, or null if it's empty.
+	Maybe<T> pop_back()
 	{
 		_validate();
-		auto [bucket, b_occupied] = this->find(key);
-		if (b_occupied) {
-			if constexpr (std::is_reference_v<V>) {
-				return *bucket->value;
-			}
-			else {
-				return bucket->value;
-			};
-		}
-		else {
+		if (_head == _tail) {
 			return {};
 		}
+		_tail--;
+		T* slot = _slot(_tail);
+		T val = std::move(*slot);
+		slot->~T();
+		return val;
 	}
 
-	// Removes the key from the hashmap. Returns true if the key is was found, returns false
-	// otherwise.
-	bool remove(K key)
+	// Adds as many items as it can to the end, and returns how many it added. It's at most 2
+	// copies, one for each side of the wrap around.
+	usize push_n(Array<const T> items)
 	{
 		_validate();
-		auto [bucket, b_occupied] = this->find(key);
-		// you can't kill someone that doesn't exist
-		// don't quote me on this
-		if (b_occupied) {
-			bucket->dead = true;
-			this->length--;
+		usize n = tr::min(items.len(), _cap - len());
+		if (n == 0) {
+			return 0;
 		}
 
-		return b_occupied;
+		usize first = tr::min(n, _run(_tail));
+		tr::_copy_construct_items<T>(_slot(_tail), items.buf(), first);
+		tr::_copy_construct_items<T>(_buf, items.buf() + first, n - first);
+		_tail += n;
+		return n;
 	}
 
-	// Returns how many items the hashmap currently has
-	usize len() const
+	// Removes as many items as it can from the start, puts them in `out`, and returns how many
+	// it removed. It's at most 2 copies, one for each side of the wrap around. The items in
+	// `out` are assigned over, so they have to be valid already.
+	usize pop_n(Array<T> out)
 	{
 		_validate();
-		return this->length;
+		usize n = tr::min(out.len(), len());
+		if (n == 0) {
+			return 0;
+		}
+
+		usize first = tr::min(n, _run(_head));
+		tr::_move_assign_items<T>(out.buf(), _slot(_head), first);
+		tr::_move_assign_items<T>(out.buf() + first, _buf, n - first);
+		discard(n);
+		return n;
 	}
 
-	// Returns the total amount of items the hashmap can currently hold (it'll grow when it's
-	// 50% full)
-	usize cap() const
+	// Removes the first `n` items without copying them anywhere. Useful after reading them
+	// through `halves()`.
+	void discard(usize n)
 	{
 		_validate();
-		return this->capacity;
+		n = tr::min(n, len());
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			for (usize i = 0; i < n; i++) {
+				_slot(_head + i)->~T();
+			}
+		}
+		_head += n;
 	}
 
-	// fucking iterator
-	class Iterator
+	// Returns the items as 2 arrays, the first one is from the start to where it wraps around,
+	// the second one is the rest. Either of them can be empty. They're invalid after the ring
+	// buffer changes.
+	Pair<Array<T>, Array<T>> halves() const
 	{
-	public:
-		Iterator(Bucket* buf, usize index, usize capacity)
-			: buffer(buf)
-			, idx(index)
-			, cap(capacity)
-		{
-			this->find_valid();
+		_validate();
+		usize first = tr::min(len(), _run(_head));
+		return {Array<T>(_slot(_head), first), Array<T>(_buf, len() - first)};
+	}
+
+	// Returns the item at that index (0 is the first item), or null if it's out of range.
+	Maybe<T&> try_get(usize idx) const
+	{
+		_validate();
+		if (idx >= len()) {
+			return {};
 		}
+		return *_slot(_head + idx);
+	}
 
-		Pair<K&, V&> operator*() const
-		{
-			Bucket& b = this->buffer[this->idx];
-			return {b.key, b.value};
+	// Returns the item at that index (0 is the first item), or panics if it's out of range.
+	T& operator[](usize idx) const
+	{
+		if constexpr (BOUNDS_CHECK) {
+			_validate();
+			if (idx >= len()) [[unlikely]] {
+				tr::panic(
+					"index out of range: ring[%zu] when the length is %zu", idx,
+					len()
+				);
+			}
 		}
+		return *_slot(_head + idx);
+	}
 
-		Iterator& operator++()
-		{
-			this->idx++;
-			this->find_valid();
-			return *this;
+	// Returns how many items there are.
+	constexpr usize len() const
+	{
+		return _tail - _head;
+	}
+
+	// Returns how many items it can hold.
+	constexpr usize cap() const
+	{
+		return _cap;
+	}
+
+	// Removes every item.
+	void clear()
+	{
+		discard(len());
+		_head = 0;
+		_tail = 0;
+	}
+};
+
+// A double-ended queue, so you can push and pop from both ends in O(1). It's a `tr::RingBuffer<T>`
+// that grows when it's full. Pass it by reference, a copy keeps using the old buffer once the
+// original grows, and pushing to either one clobbers the other's items until then.
+template<typename T>
+requires(!std::is_reference_v<T>)
+class Deque
+{
+	Arena* _arena = nullptr;
+	RingBuffer<T> _ring;
+
+	constexpr void _validate() const
+	{
+		if (_arena == nullptr) [[unlikely]] {
+			tr::panic("uninitialized tr::Deque<T>!");
 		}
+	}
 
-		bool operator!=(const Iterator& other) const
-		{
-			return this->idx != other.idx;
+	void _grow(usize min_cap)
+	{
+		RingBuffer<T> bigger{*_arena, tr::max(_ring._cap * 2, min_cap)};
+		// the old buffer stays in the arena, like with arrays. the new one is uninitialized
+		// so the items are constructed there, not assigned like `pop_n()` does
+		usize n = _ring.len();
+		usize first = tr::min(n, _ring._run(_ring._head));
+		tr::_move_construct_items<T>(bigger._buf, _ring._slot(_ring._head), first);
+		tr::_move_construct_items<T>(bigger._buf + first, _ring._buf, n - first);
+		_ring.discard(n);
+		bigger._tail = n;
+		_ring = bigger;
+	}
+
+public:
+	using Type = T;
+
+	constexpr Deque() {}
+
+	// Initializes an empty deque at an arena.
+	explicit Deque(Arena& arena, usize capacity = ARRAY_INITIAL_CAPACITY)
+		: _arena(&arena)
+		, _ring(arena, capacity)
+	{
+	}
+
+	// Adds an item to the end, and grows if necessary.
+	void push_back(T val)
+	{
+		_validate();
+		if (_ring.len() == _ring.cap()) [[unlikely]] {
+			_grow(_ring.cap() + 1);
 		}
+		(void)_ring.push_back(std::move(val));
+	}
 
-	private:
-		Bucket* buffer;
-		usize idx;
-		usize cap;
+	// Adds an item to the start, and grows if necessary.
+	void push_front(T val)
+	{
+		_validate();
+		if (_ring.len() == _ring.cap()) [[unlikely]] {
+			_grow(_ring.cap() + 1);
+		}
+		(void)_ring.push_front(std::move(val));
+	}
 
-		void find_valid()
-		{
-			// god
-			while (this->idx < this->cap && (!this->buffer[this->idx].occupied ||
-							 this->buffer[this->idx].dead)) {
-				this->idx++;
-			}
+	// Removes the first item and returns it, or null if it's empty.
+	Maybe<T> pop_front()
+	{
+		_validate();
+		return _ring.pop_front();
+	}
+
+	// Removes the last item and returns it, or null if it's empty.
+	Maybe<T> pop_back()
+	{
+		_validate();
+		return _ring.pop_back();
+	}
+
+	// Adds every item to the end, growing if necessary. It's at most 2 copies, one for each
+	// side of the wrap around.
+	void push_n(Array<const T> items)
+	{
+		_validate();
+		if (_ring.len() + items.len() > _ring.cap()) {
+			_grow(_ring.len() + items.len());
 		}
-	};
+		(void)_ring.push_n(items);
+	}
 
-	Iterator begin() const
+	// Removes as many items as it can from the start, puts them in `out`, and returns how many
+	// it removed. It's at most 2 copies, one for each side of the wrap around. The items in
+	// `out` are assigned over, so they have to be valid already.
+	usize pop_n(Array<T> out)
 	{
 		_validate();
-		return Iterator(this->buffer, 0, this->capacity);
+		return _ring.pop_n(out);
 	}
 
-	Iterator end() const
+	// Removes the first `n` items without copying them anywhere. Useful after reading them
+	// through `halves()`.
+	void discard(usize n)
+	{
+		_validate();
+		_ring.discard(n);
+	}
+
+	// Returns the items as 2 arrays, the first one is from the start to where it wraps around,
+	// the second one is the rest. Either of them can be empty. They're invalid after the
+	// deque changes.
+	Pair<Array<T>, Array<T>> halves() const
+	{
+		_validate();
+		return _ring.halves();
+	}
+
+	// Returns the item at that index (0 is the first item), or null if it's out of range.
+	Maybe<T&> try_get(usize idx) const
+	{
+		_validate();
+		return _ring.try_get(idx);
+	}
+
+	// Returns the item at that index (0 is the first item), or panics if it's out of range.
+	T& operator[](usize idx) const
+	{
+		return _ring[idx];
+	}
+
+	// Returns how many items there are.
+	constexpr usize len() const
+	{
+		return _ring.len();
+	}
+
+	// Returns how many items it can hold before having to grow.
+	constexpr usize cap() const
+	{
+		return _ring.cap();
+	}
+
+	// Removes every item. The memory is kept around for new items.
+	void clear()
 	{
 		_validate();
-		return Iterator(this->buffer + this->capacity, this->capacity, this->capacity);
+		_ring.clear();
 	}
 };
 
@@ -447,7 +2109,7 @@ private:
 	static int64 _time_now_us();
 };
 
-// TODO HashSet<T>, Stack<T>, Queue<T>, LinkedList<T>
+// TODO Stack<T>, LinkedList<T>
 
 }
 